@@ -13,21 +13,11 @@ TEMPLATE = app
 
 RC_ICONS = trade.ico
 
+include(core.pri) # the solver
+
 SOURCES += main.cpp\
-        mainwindow.cpp \
-    parser.cpp \
-    graph.cpp \
-    heap.cpp \
-    javarand.cpp \
-    exec.cpp \
-    metric.cpp
-
-HEADERS  += mainwindow.h \
-    parser.h \
-    graph.h \
-    heap.h \
-    javarand.h \
-    exec.h \
-    metric.h
+        mainwindow.cpp
+
+HEADERS  += mainwindow.h
 
 FORMS    += mainwindow.ui
@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# tradebench: times the solver kernels on generated want files
+#
+#-------------------------------------------------
+
+QT       += core concurrent
+QT       -= gui
+
+TARGET = tradebench
+TEMPLATE = app
+CONFIG   += console
+CONFIG   -= app_bundle
+
+include(../core.pri) # the solver
+
+INCLUDEPATH += ../wantgen
+DEPENDPATH  += ../wantgen
+
+SOURCES += main.cpp \
+    ../wantgen/wantgen.cpp
+
+HEADERS += ../wantgen/wantgen.h
+
+# "make check" runs the TradeMaximizer check cases in check/
+check.depends  = $(TARGET)
+check.commands = ./$$TARGET --check $$PWD/check/manifest.txt
+QMAKE_EXTRA_TARGETS += check
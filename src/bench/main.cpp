@@ -0,0 +1,897 @@
+#include <QCoreApplication>
+#include <QCommandLineParser> // for the arguments
+#include <QElapsedTimer>      // for timing the kernels
+#include <QFile>              // for writing the results
+#include <QFileInfo>          // for naming the inputs
+#include <QDir>               // for finding the check cases
+#include <QRegExp>            // for reading them
+#include <QStringList>
+#include <QtConcurrent>       // for the solve time limit
+#include <QMutex>             // ditto
+#include <QWaitCondition>     // ditto
+#include <QThread>            // for the core count
+#include <stdio.h>            // for writing to stderr
+#include <stdlib.h>           // for malloc() and friends
+#include "exec.h"
+#include "parser.h"
+#include "graph.h"
+#include "heap.h"
+#include "metric.h"
+#include "wantgen.h"
+
+extern QHash<QString, OptionType> gOptions;
+
+//////////// ALLOCATION COUNTING
+
+// Every allocation goes through malloc(), whether from new or from the Qt
+// containers, so counting them there catches them all. glibc lets a
+// program wrap its own malloc(); elsewhere the counts are reported as -1.
+static QAtomicInteger<quint64> gAllocs;
+
+#if defined(__GLIBC__)
+#define COUNT_ALLOCS
+extern "C"
+{
+  void *__libc_malloc(size_t size);
+  void *__libc_calloc(size_t num, size_t size);
+  void *__libc_realloc(void *ptr, size_t size);
+
+  void *malloc(size_t size)
+  {
+    gAllocs.fetchAndAddRelaxed(1);
+    return __libc_malloc(size);
+  }
+  void *calloc(size_t num, size_t size)
+  {
+    gAllocs.fetchAndAddRelaxed(1);
+    return __libc_calloc(num, size);
+  }
+  void *realloc(void *ptr, size_t size)
+  {
+    gAllocs.fetchAndAddRelaxed(1);
+    return __libc_realloc(ptr, size);
+  }
+}
+#endif
+
+
+//////////// TIMING
+
+// Accumulates the timed parts of a kernel's repetitions. Each repetition
+// does its setup, then times just the kernel between start() and stop().
+class Timing
+{
+  public:
+    Timing(qint64 minNsecs, int minReps);
+    bool more() const { return reps < minReps || nsecs < minNsecs; }
+    void start();
+    void stop(qint64 ops);
+
+    qint64 nsecs;  // time spent in the kernel
+    qint64 ops;    // operations done, in the kernel's own unit
+    qint64 allocs; // allocations made by the kernel
+    int reps;
+
+  private:
+    QElapsedTimer timer;
+    quint64 allocsAtStart;
+    qint64 minNsecs;
+    int minReps;
+};
+
+Timing::Timing(qint64 minNsecs, int minReps)
+{
+  this->minNsecs = minNsecs;
+  this->minReps = minReps;
+  nsecs = 0;
+  ops = 0;
+  allocs = 0;
+  reps = 0;
+}
+
+void Timing::start()
+{
+  allocsAtStart = gAllocs.loadAcquire();
+  timer.start();
+}
+
+void Timing::stop(qint64 ops)
+{
+  nsecs += timer.nsecsElapsed();
+  allocs += gAllocs.loadAcquire() - allocsAtStart;
+  this->ops += ops;
+  reps++;
+}
+
+
+//////////// REPORTING
+
+// Soaks up the progress reports from parseInput() and buildGraph()
+class QuietReporter : public Reporter
+{
+  public:
+    void setBarFormat(QString, int) {}
+    void setBarVal(int) {}
+    void displayTxt(QString) {}
+    void displayStats(QString, QString, QString, QString, QString, QString) {}
+    void inputError(QString str) { fprintf(stderr, "Input error: %s\n", qPrintable(str)); }
+    void runComplete(QString) {}
+};
+
+static QStringList gResults; // one JSON object per kernel and size
+static QString gFilter;       // only run the kernels whose names contain this
+static volatile int gSink;    // keeps results the compiler could otherwise skip
+
+static bool wanted(QString kernel)
+{
+  return kernel.contains(gFilter);
+}
+
+static void report(QString kernel, int size, const Timing &t, QString unit)
+{
+  double nsPerOp = (double)t.nsecs / qMax(t.ops, (qint64)1);
+  double opsPerSec = t.nsecs > 0 ? t.ops * 1e9 / t.nsecs : 0;
+  double allocsPerOp = -1;
+#if defined(COUNT_ALLOCS)
+  allocsPerOp = (double)t.allocs / qMax(t.ops, (qint64)1);
+#endif
+
+  gResults.append(QString("{\"kernel\": \"%1\", \"items\": %2, \"reps\": %3, \"ops\": %4, "
+                          "\"unit\": \"%5\", \"ns_per_op\": %6, \"allocs_per_op\": %7, "
+                          "\"ops_per_sec\": %8}")
+                  .arg(kernel).arg(size).arg(t.reps).arg(t.ops).arg(unit)
+                  .arg(nsPerOp, 0, 'f', 2).arg(allocsPerOp, 0, 'f', 3).arg(opsPerSec, 0, 'f', 0));
+  fprintf(stderr, "%-28s %8d items %12.2f ns/%-7s %9.3f allocs/%-7s %7d reps\n",
+          qPrintable(kernel), size, nsPerOp, qPrintable(unit), allocsPerOp, qPrintable(unit), t.reps);
+}
+
+
+//////////// KERNELS
+
+// The heaps are driven the way dijkstra() drives them: fill, then extract
+// in order while lowering the cost of some of the entries still waiting.
+// The lowered costs never drop below the last one extracted, so the radix
+// and bucket heaps are exercised within their rules. Each insert, extract
+// and decrease counts as an operation.
+template <class HeapType>
+static void benchHeap(QString kernel, int size, quint64 seed, qint64 minNsecs, int minReps)
+{
+  if (!wanted(kernel))
+    return;
+
+  JavaRand rand(seed);
+  QVector<quint64> costs(size);
+  for (int idx=0; idx<size; idx++)
+    costs[idx] = rand.nextInt(1 << 16);
+  QVector<int> lowered(size); // entries to lower after each extract
+  for (int idx=0; idx<size; idx++)
+    lowered[idx] = rand.nextInt(size);
+
+  HeapType heap;
+  heap.resize(size);
+  QVector<char> done(size);
+  Timing t(minNsecs, minReps);
+  while (t.more())
+  {
+    done.fill(0);
+    heap.clear();
+    qint64 ops = 0;
+    t.start();
+    for (int idx=0; idx<size; idx++)
+      heap.insert(idx, costs.at(idx));
+    ops += size;
+    for (int idx=0; !heap.isEmpty(); idx++)
+    {
+      int node = heap.extractMin();
+      done[node] = 1;
+      quint64 last = heap.cost(node);
+      int other = lowered.at(idx);
+      if (!done.at(other) && heap.cost(other) > last + 1)
+      {
+        heap.decreaseCost(other, last + (heap.cost(other) - last)/2);
+        ops++;
+      }
+      ops++;
+    }
+    t.stop(ops);
+  }
+  report(kernel, size, t, "op");
+}
+
+
+static void deleteCycles(CyclesType *ptrCycles)
+{
+  if (ptrCycles != NULL)
+  {
+    qDeleteAll(*ptrCycles);
+    delete ptrCycles;
+  }
+}
+
+
+// Sets up a graph the way Exec::go() does
+static void prepareGraph(Graph &graph, QAtomicInt *ptrKeepRunning, QAtomicInt *ptrPaused)
+{
+  graph.ptrKeepRunning = ptrKeepRunning;
+  graph.ptrPaused = ptrPaused;
+  graph.heapType = (HEAP_TYPE)gOptions["heapType"].value;
+  graph.lazyDijkstra = gOptions["lazyDijkstra"].enabled;
+  graph.multiAugment = gOptions["multiAugment"].enabled;
+  graph.splitComponents = gOptions["splitComponents"].enabled;
+}
+
+
+// Times the graph kernels on a generated want file of the given size. The
+// options are applied as if they were on the file's #! line.
+static void benchGraph(int size, quint64 seed, QString options, qint64 minNsecs, int minReps)
+{
+  QuietReporter reporter;
+  QAtomicInt keepRunning(1), paused(0);
+
+  WantGenType gen;
+  setDefaultWantGen(gen, size);
+  gen.seed = seed;
+  ParseDataType parsed;
+  if (!parseInput(&reporter, generateWants(gen), parsed, options))
+    return;
+
+  // Build and cull a fresh graph for each repetition
+  if (wanted("removeImpossibleEdges"))
+  {
+    Timing t(minNsecs, minReps);
+    while (t.more())
+    {
+      ParseDataType copy = parsed; // buildGraph() modifies it
+      Graph graph;
+      prepareGraph(graph, &keepRunning, &paused);
+      buildGraph(&reporter, copy, graph);
+      t.start();
+      graph.removeImpossibleEdges();
+      t.stop(graph.wanters.size());
+    }
+    report("removeImpossibleEdges", size, t, "item");
+  }
+
+  Graph graph;
+  prepareGraph(graph, &keepRunning, &paused);
+  ParseDataType copy = parsed;
+  buildGraph(&reporter, copy, graph);
+  graph.removeImpossibleEdges();
+  int numItems = graph.wanters.size();
+
+  if (wanted("shuffle"))
+  {
+    JavaRand rand(seed);
+    Timing t(minNsecs, minReps);
+    while (t.more())
+    {
+      t.start();
+      graph.shuffle(rand);
+      t.stop(numItems);
+    }
+    report("shuffle", size, t, "item");
+  }
+
+  if (wanted("copy"))
+  {
+    Timing t(minNsecs, minReps);
+    while (t.more())
+    {
+      Graph *ptrCopy = new Graph();
+      t.start();
+      graph.copy(ptrCopy);
+      t.stop(numItems);
+      delete ptrCopy;
+    }
+    report("copy", size, t, "item");
+  }
+
+  // findCycles() is the Dijkstra rounds of the matching, plus reading the
+  // cycles back out. Each repetition solves a fresh copy. The metrics are
+  // timed on the last one.
+  CyclesType *ptrCycles = NULL;
+  Graph *ptrSolved = NULL;
+  if (wanted("findCycles") || wanted("metric/"))
+  {
+    Timing t(minNsecs, wanted("findCycles") ? minReps : 1);
+    if (!wanted("findCycles"))
+      t.nsecs = minNsecs; // just solve it once for the metrics
+    while (t.more())
+    {
+      Graph *ptrCopy = new Graph();
+      graph.copy(ptrCopy);
+      t.start();
+      CyclesType *ptrNewCycles = ptrCopy->findCycles();
+      t.stop(numItems);
+      deleteCycles(ptrCycles);
+      delete ptrSolved;
+      ptrCycles = ptrNewCycles;
+      ptrSolved = ptrCopy;
+    }
+    if (wanted("findCycles"))
+      report("findCycles", size, t, "item");
+  }
+  if (ptrCycles == NULL)
+    return;
+
+  // The metrics are scored for every iteration, but only described for the
+  // ones that get reported, so time both
+  const char *metricNames[] = { "CHAIN-SIZES-SOS", "USERS-TRADING", "USERS-SOS", "COMBINE-SHIPPING" };
+  int numTrades = 0;
+  for (int idx=0; idx<ptrCycles->size(); idx++)
+    numTrades += ptrCycles->at(idx)->size();
+  for (int metric=CHAIN_SIZES_SOS; metric<=COMBINE_SHIPPING; metric++)
+  {
+    MetricFunction calcMetric = metricFunction((METRIC_TYPE)metric);
+    for (int describe=0; describe<2; describe++)
+    {
+      QString kernel = QString("metric/") + metricNames[metric] + (describe ? "+text" : "");
+      if (!wanted(kernel))
+        continue;
+      Timing t(minNsecs, minReps);
+      QString metString;
+      while (t.more())
+      {
+        t.start();
+        gSink = gSink + calcMetric(ptrCycles, describe ? &metString : NULL);
+        t.stop(numTrades);
+      }
+      report(kernel, size, t, "trade");
+    }
+  }
+  deleteCycles(ptrCycles);
+  delete ptrSolved;
+}
+
+
+//////////// MACRO BENCHMARK
+
+// The memory high-water mark can only be reset on Linux, so elsewhere each
+// phase reports the peak of the whole run so far (or -1 if unknown)
+static void resetPeakMemory()
+{
+#if defined(Q_OS_LINUX)
+  QFile clearRefs("/proc/self/clear_refs");
+  if (clearRefs.open(QIODevice::WriteOnly))
+    clearRefs.write("5");
+#endif
+}
+
+static qint64 peakMemoryKb()
+{
+#if defined(Q_OS_LINUX)
+  QFile status("/proc/self/status");
+  if (status.open(QIODevice::ReadOnly))
+  {
+    QStringList lines = QString(status.readAll()).split("\n");
+    for (int idx=0; idx<lines.size(); idx++)
+      if (lines.at(idx).startsWith("VmHWM:"))
+        return lines.at(idx).mid(6).trimmed().split(" ").at(0).toLongLong();
+  }
+#endif
+  return -1;
+}
+
+
+// Times the phases of a run and the peak memory of each
+class Phases
+{
+  public:
+    void start(QString name);
+    void stop();
+    void report(QString input, int size, QString extra);
+    qint64 msecs(QString name) const { return timed.value(name, -1); }
+
+  private:
+    QStringList json;
+    QHash<QString, qint64> timed; // phase -> ms
+    QString name;
+    QElapsedTimer timer;
+    qint64 totalMsecs;
+};
+
+void Phases::start(QString name)
+{
+  this->name = name;
+  resetPeakMemory();
+  timer.start();
+}
+
+void Phases::stop()
+{
+  qint64 msecs = timer.elapsed();
+  qint64 peakKb = peakMemoryKb();
+  timed[name] = msecs;
+  json.append(QString("{\"phase\": \"%1\", \"ms\": %2, \"peak_rss_kb\": %3}")
+              .arg(name).arg(msecs).arg(peakKb));
+  fprintf(stderr, "  %-10s %10lld ms %10lld KB peak\n", qPrintable(name), msecs, peakKb);
+}
+
+void Phases::report(QString input, int size, QString extra)
+{
+  gResults.append(QString("{\"kernel\": \"macro\", \"input\": \"%1\", \"items\": %2, %3, "
+                          "\"phases\": [%4]}")
+                  .arg(input).arg(size).arg(extra).arg(json.join(", ")));
+}
+
+
+// Runs a want file through the whole pipeline once: parse, build, cull and
+// solve one iteration, like the first iteration of a run. The solve is
+// canceled if it goes past timeLimit seconds, as a TradeMaximizer-style
+// solve of a big input can take hours.
+static void runMacro(QString input, const QByteArray &data, Phases &phases,
+                     QString options, int timeLimit)
+{
+  QuietReporter reporter;
+  QAtomicInt keepRunning(1), paused(0);
+  ParseDataType parsed;
+  Graph graph;
+
+  phases.start("parse");
+  bool ok = parseInput(&reporter, data, parsed, options);
+  phases.stop();
+  if (!ok)
+    return;
+
+  phases.start("build");
+  prepareGraph(graph, &keepRunning, &paused);
+  buildGraph(&reporter, parsed, graph);
+  phases.stop();
+
+  phases.start("cull");
+  graph.removeImpossibleEdges();
+  phases.stop();
+
+  // A watchdog on a thread of its own cancels the solve at the time limit
+  QThreadPool watchdogPool;
+  QMutex lock;
+  QWaitCondition solved;
+  bool done = false;
+  QFuture<void> watchdog = QtConcurrent::run(&watchdogPool, [&]()
+  {
+    QMutexLocker locker(&lock);
+    QElapsedTimer waited;
+    waited.start();
+    while (!done && waited.elapsed() < timeLimit*1000LL)
+      solved.wait(&lock, timeLimit*1000LL - waited.elapsed());
+    if (!done)
+      keepRunning.storeRelease(0);
+  });
+
+  phases.start("solve");
+  Graph *ptrCopy = new Graph();
+  graph.copy(ptrCopy);
+  CyclesType *ptrCycles = ptrCopy->findCycles();
+  phases.stop();
+
+  lock.lock();
+  done = true;
+  solved.wakeAll();
+  lock.unlock();
+  watchdog.waitForFinished();
+
+  int numTrades = 0;
+  if (ptrCycles != NULL)
+    for (int idx=0; idx<ptrCycles->size(); idx++)
+      numTrades += ptrCycles->at(idx)->size();
+  if (ptrCycles == NULL)
+    fprintf(stderr, "  (solve canceled after %d s)\n", timeLimit);
+  phases.report(input, parsed.numItems,
+                QString("\"trades\": %1, \"canceled\": %2")
+                .arg(numTrades).arg(ptrCycles == NULL ? "true" : "false"));
+  deleteCycles(ptrCycles);
+  delete ptrCopy;
+}
+
+
+//////////// THREAD SCALING
+
+// Keeps the results and ends the event loop when a run is complete
+class RunReporter : public Reporter
+{
+  public:
+    void setBarFormat(QString, int) {}
+    void setBarVal(int) {}
+    void displayTxt(QString) {}
+    void displayStats(QString, QString, QString, QString, QString, QString) {}
+    void inputError(QString str) { fprintf(stderr, "Input error: %s\n", qPrintable(str)); }
+    void runComplete(QString results) { this->results = results; QCoreApplication::exit(0); }
+
+    QString results;
+};
+
+
+// Runs the same input and seed through the whole pipeline with each of the
+// thread counts, and reports how the iteration throughput scales and how
+// much of the time the workers and the producer spent waiting. Workers
+// waiting means the producer's shuffle and copy are the bottleneck; the
+// producer waiting means the workers are.
+static void benchScaling(QCoreApplication &app, QString input, const QByteArray &data,
+                         QString options, QList<int> threadCounts)
+{
+  double baseRate = 0;
+  for (int idx=0; idx<threadCounts.size(); idx++)
+  {
+    int numThreads = threadCounts.at(idx);
+    QThreadPool::globalInstance()->setMaxThreadCount(numThreads);
+
+    RunReporter reporter;
+    QAtomicInt keepRunning(1), paused(0);
+    Exec *ptrExec = new Exec(&reporter);
+    QElapsedTimer wall;
+    wall.start();
+    ptrExec->go(data, input, &keepRunning, &paused, options);
+    app.exec();
+    qint64 wallMsecs = wall.elapsed();
+    PipelineStatsType stats = ptrExec->pipelineStats();
+    delete ptrExec;
+
+    double pipelineSecs = stats.pipelineNsecs / 1e9;
+    double rate = pipelineSecs > 0 ? stats.iterations / pipelineSecs : 0;
+    if (idx == 0)
+      baseRate = rate / numThreads; // per thread, in case the first count isn't 1
+    double speedup = baseRate > 0 ? rate / baseRate : 0;
+    double efficiency = speedup / numThreads;
+    QStringList idleMsecs;
+    qint64 totalIdle = 0;
+    for (int worker=0; worker<stats.workerIdleNsecs.size(); worker++)
+    {
+      idleMsecs.append(QString::number(stats.workerIdleNsecs.at(worker) / 1000000));
+      totalIdle += stats.workerIdleNsecs.at(worker);
+    }
+    double idleShare = stats.pipelineNsecs > 0
+                       ? (double)totalIdle / stats.numWorkers / stats.pipelineNsecs : 0;
+    double waitShare = stats.pipelineNsecs > 0
+                       ? (double)stats.producerWaitNsecs / stats.pipelineNsecs : 0;
+
+    gResults.append(QString("{\"kernel\": \"scaling\", \"input\": \"%1\", \"threads\": %2, "
+                            "\"iterations\": %3, \"wall_ms\": %4, \"pipeline_ms\": %5, "
+                            "\"iter_per_sec\": %6, \"speedup\": %7, \"efficiency\": %8, "
+                            "\"producer_wait_ms\": %9, \"worker_idle_ms\": [%10]}")
+                    .arg(input).arg(numThreads).arg(stats.iterations).arg(wallMsecs)
+                    .arg(stats.pipelineNsecs / 1000000).arg(rate, 0, 'f', 2)
+                    .arg(speedup, 0, 'f', 2).arg(efficiency, 0, 'f', 3)
+                    .arg(stats.producerWaitNsecs / 1000000).arg(idleMsecs.join(", ")));
+    fprintf(stderr, "%4d threads %8d iters %9lld ms %9.2f iters/s %6.2fx %5.1f%% efficient"
+                    " %5.1f%% worker idle %5.1f%% producer wait\n",
+            numThreads, stats.iterations, wallMsecs, rate, speedup, 100*efficiency,
+            100*idleShare, 100*waitShare);
+  }
+}
+
+
+//////////// TRADEMAXIMIZER CHECK
+
+// The part of a run's output that TradeMaximizer's should match line for
+// line: the missing names, errors, loops, summary and stats, without the
+// HTML, the elapsed time, the PROFILE report or trailing whitespace. The
+// header and options lines differ by design, and the improvements found
+// along the way ("[ ... ]") come in the order the workers finish.
+static QStringList comparable(QString results)
+{
+  results.remove("<br>"); // each is followed by a newline
+  results.remove(QRegExp("<[^>]*>"));
+  QStringList lines = results.split("\n");
+  QStringList kept;
+  bool started = false;
+  for (int idx=0; idx<lines.size(); idx++)
+  {
+    QString line = lines.at(idx);
+    line.remove(QRegExp("\\s+$"));
+    if (line.startsWith("PROFILE:"))
+      break;
+    if (line.startsWith("**** Missing") || line.startsWith("ERRORS:") ||
+        line.startsWith("TRADE LOOPS") || line.startsWith("ITEM SUMMARY") ||
+        line.startsWith("Num trades"))
+      started = true;
+    if (started && !line.startsWith("Elapsed time") && !line.startsWith("["))
+      kept.append(line);
+  }
+  while (!kept.isEmpty() && kept.last().isEmpty())
+    kept.removeLast();
+  return kept;
+}
+
+
+// Runs one case of a check manifest. Each line of the manifest is
+//
+//   <wants> <expected> <budgets> [options...]
+//
+// where <wants> is a want file, <expected> is what TradeMaximizer (or a
+// build known to match it) wrote for it with the same options, and
+// <budgets> is "-" or comma-separated phase:ms limits, e.g.,
+// "run:2000,solve:300". The options, e.g., "SEED=7 ITERATIONS=10", are read
+// before the want file's own. Paths are relative to the manifest. The whole
+// run ("run") must match the expected output, and each budgeted phase must
+// finish within its budget. The parse, build, cull and solve phases are
+// timed as with --macro. With "totals:<expected>", only the "Num trades"
+// and "Total cost" lines must match. Every minimum cost matching has the
+// same totals, but solver modes that break ties differently can find other
+// loops, and so another best iteration.
+static bool checkCase(QCoreApplication &app, const QDir &dir, QString line, int timeLimit)
+{
+  QStringList fields = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+  if (fields.size() < 3)
+  {
+    fprintf(stderr, "Bad check case: %s\n", qPrintable(line));
+    return false;
+  }
+  QString name = fields.at(0);
+  QString options = QStringList(fields.mid(3)).join(" ");
+  QString expectedName = fields.at(1);
+  bool totalsOnly = expectedName.startsWith("totals:");
+  if (totalsOnly)
+    expectedName = expectedName.mid(7);
+  QFile wants(dir.filePath(fields.at(0)));
+  QFile expected(dir.filePath(expectedName));
+  if (!wants.open(QIODevice::ReadOnly) || !expected.open(QIODevice::ReadOnly))
+  {
+    fprintf(stderr, "Could not open %s or %s\n", qPrintable(wants.fileName()),
+            qPrintable(expected.fileName()));
+    return false;
+  }
+  QByteArray data = wants.readAll();
+  fprintf(stderr, "check %s %s\n", qPrintable(name), qPrintable(options));
+
+  Phases phases;
+  RunReporter reporter;
+  QAtomicInt keepRunning(1), paused(0);
+  Exec *ptrExec = new Exec(&reporter);
+  phases.start("run");
+  ptrExec->go(data, name, &keepRunning, &paused, options);
+  app.exec();
+  phases.stop();
+  delete ptrExec;
+
+  // The phases within a run are only timed if they have budgets, as that
+  // takes a run of their own
+  QStringList budgets = fields.at(2) == "-" ? QStringList() : fields.at(2).split(",");
+  for (int idx=0; idx<budgets.size(); idx++)
+    if (budgets.at(idx).section(":", 0, 0) != "run")
+    {
+      runMacro(name, data, phases, options, timeLimit);
+      break;
+    }
+
+  // Report the first line that differs
+  QStringList got = comparable(reporter.results);
+  QStringList want = comparable(QString::fromUtf8(expected.readAll()));
+  if (totalsOnly)
+  {
+    QRegExp totals("^(Num trades|Total cost) ");
+    got = got.filter(totals);
+    want = want.filter(totals);
+  }
+  int diffLine = -1;
+  for (int idx=0; idx<qMax(got.size(), want.size()) && diffLine<0; idx++)
+    if (idx >= got.size() || idx >= want.size() || got.at(idx) != want.at(idx))
+      diffLine = idx;
+  if (diffLine >= 0)
+    fprintf(stderr, "  MISMATCH at line %d of the results:\n    expected: %s\n    got:      %s\n",
+            diffLine+1, qPrintable(diffLine < want.size() ? want.at(diffLine) : "(end)"),
+            qPrintable(diffLine < got.size() ? got.at(diffLine) : "(end)"));
+
+  QStringList overBudget;
+  for (int idx=0; idx<budgets.size(); idx++)
+  {
+    QString phase = budgets.at(idx).section(":", 0, 0);
+    qint64 budget = budgets.at(idx).section(":", 1).toLongLong();
+    qint64 msecs = phases.msecs(phase);
+    if (msecs < 0)
+      fprintf(stderr, "  no phase %s to budget\n", qPrintable(phase));
+    else if (msecs <= budget)
+      continue;
+    else
+      fprintf(stderr, "  OVER BUDGET: %s took %lld ms of %lld\n", qPrintable(phase), msecs, budget);
+    overBudget.append("\"" + phase + "\"");
+  }
+
+  gResults.append(QString("{\"kernel\": \"check\", \"input\": \"%1\", \"options\": \"%2\", "
+                          "\"match\": %3, \"diff_line\": %4, \"run_ms\": %5, "
+                          "\"over_budget\": [%6]}")
+                  .arg(name).arg(QString(options).replace("\"", "\\\""))
+                  .arg(diffLine < 0 ? "true" : "false").arg(diffLine < 0 ? -1 : diffLine+1)
+                  .arg(phases.msecs("run"))
+                  .arg(overBudget.join(", ")));
+  return diffLine < 0 && overBudget.isEmpty();
+}
+
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("tradebench");
+
+  QCommandLineParser args;
+  args.setApplicationDescription("Times the solver kernels on generated want files. With "
+                                 "--macro, times each phase of a run instead, on generated "
+                                 "want files or the ones given. With --check, compares runs "
+                                 "against TradeMaximizer's results and phase time budgets.");
+  args.addHelpOption();
+  args.addPositionalArgument("wants", "With --macro, want files to use instead of generated ones.",
+                             "[wants...]");
+  QCommandLineOption sizesOpt(QStringList() << "s" << "sizes",
+                              "Comma-separated item counts (default: 1000,3000,10000, or "
+                              "1000,10000,100000,1000000 with --macro).", "sizes");
+  QCommandLineOption macroOpt("macro", "Time the parse, build, cull and solve phases of a run, "
+                              "and the peak memory of each.");
+  QCommandLineOption scalingOpt("scaling", "Run the whole pipeline with each thread count, and "
+                                "report the speedup and how busy the threads were.");
+  QCommandLineOption checkOpt("check", "Run each case in <manifest> and compare its results "
+                              "with TradeMaximizer's and its phase times with their budgets. "
+                              "Exits with 1 if any case fails.", "manifest");
+  QCommandLineOption threadsOpt(QStringList() << "t" << "threads",
+                                "With --scaling, comma-separated thread counts (default: "
+                                "1, 2, 4, ... up to one per core).", "counts");
+  QCommandLineOption itersOpt("iterations", "With --scaling, the ITERATIONS for each run, "
+                              "unless the want file sets them (default: 64).", "n", "64");
+  QCommandLineOption limitOpt("time-limit", "With --macro, cancel a solve after <s> seconds "
+                              "(default: 600).", "s", "600");
+  QCommandLineOption seedOpt("seed", "Seed for the generated inputs (default: 1).", "seed", "1");
+  QCommandLineOption timeOpt("min-time", "Time each kernel for at least <ms> (default: 500).", "ms", "500");
+  QCommandLineOption repsOpt("min-reps", "Repeat each kernel at least <n> times (default: 1).", "n", "1");
+  QCommandLineOption filterOpt(QStringList() << "k" << "kernels",
+                               "Only run the kernels whose names contain <text>.", "text");
+  QCommandLineOption optionsOpt(QStringList() << "O" << "options",
+                                "Want-file options for the generated inputs, as on a "
+                                "#! line, e.g., \"HEAP=RADIX LAZY-DIJKSTRA\".", "options");
+  QCommandLineOption outOpt(QStringList() << "o" << "output",
+                            "Write the JSON results to <file> instead of stdout.", "file");
+  args.addOption(sizesOpt);
+  args.addOption(macroOpt);
+  args.addOption(scalingOpt);
+  args.addOption(checkOpt);
+  args.addOption(threadsOpt);
+  args.addOption(itersOpt);
+  args.addOption(limitOpt);
+  args.addOption(seedOpt);
+  args.addOption(timeOpt);
+  args.addOption(repsOpt);
+  args.addOption(filterOpt);
+  args.addOption(optionsOpt);
+  args.addOption(outOpt);
+  args.process(app);
+
+  quint64 seed = args.value(seedOpt).toULongLong();
+  qint64 minNsecs = args.value(timeOpt).toLongLong() * 1000000;
+  int minReps = qMax(1, args.value(repsOpt).toInt());
+  QString options = args.value(optionsOpt);
+  gFilter = args.value(filterOpt);
+  if (args.isSet(scalingOpt))
+  {
+    QList<int> threadCounts;
+    if (args.isSet(threadsOpt))
+    {
+      QStringList counts = args.value(threadsOpt).split(",");
+      for (int idx=0; idx<counts.size(); idx++)
+        threadCounts.append(qMax(1, counts.at(idx).toInt()));
+    }
+    else
+    {
+      int numCores = QThread::idealThreadCount();
+      for (int count=1; count<numCores; count*=2)
+        threadCounts.append(count);
+      threadCounts.append(numCores);
+    }
+
+    // The seed and iterations go first, so the want file can override them
+    QString runOptions = "SEED=" + QString::number(seed) + " ITERATIONS=" + args.value(itersOpt)
+                         + " " + options;
+    QStringList files = args.positionalArguments();
+    for (int idx=0; idx<files.size(); idx++)
+    {
+      QFile file(files.at(idx));
+      if (!file.open(QIODevice::ReadOnly))
+      {
+        fprintf(stderr, "Could not open %s\n", qPrintable(files.at(idx)));
+        return 1;
+      }
+      QString name = QFileInfo(files.at(idx)).fileName();
+      fprintf(stderr, "scaling %s\n", qPrintable(name));
+      benchScaling(app, name, file.readAll(), runOptions, threadCounts);
+    }
+    if (files.isEmpty())
+    {
+      int size = args.isSet(sizesOpt) ? args.value(sizesOpt).split(",").at(0).toInt() : 1000;
+      WantGenType gen;
+      setDefaultWantGen(gen, qMax(1, size));
+      gen.seed = seed;
+      fprintf(stderr, "scaling %d generated items\n", gen.numItems);
+      benchScaling(app, "generated", generateWants(gen), runOptions, threadCounts);
+    }
+  }
+
+  bool macro = args.isSet(macroOpt);
+  QString defaultSizes = macro ? "1000,10000,100000,1000000" : "1000,3000,10000";
+  QStringList sizes = args.isSet(sizesOpt) ? args.value(sizesOpt).split(",") : defaultSizes.split(",");
+  QStringList files = args.positionalArguments();
+  if (macro && !files.isEmpty())
+    sizes.clear(); // use just the files
+
+  for (int idx=0; idx<files.size() && macro; idx++)
+  {
+    QFile file(files.at(idx));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+      fprintf(stderr, "Could not open %s\n", qPrintable(files.at(idx)));
+      return 1;
+    }
+    QString name = QFileInfo(files.at(idx)).fileName();
+    fprintf(stderr, "macro %s\n", qPrintable(name));
+    Phases phases;
+    runMacro(name, file.readAll(), phases, options, args.value(limitOpt).toInt());
+  }
+
+  bool passed = true;
+  if (args.isSet(checkOpt))
+  {
+    QFile manifest(args.value(checkOpt));
+    if (!manifest.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+      fprintf(stderr, "Could not open %s\n", qPrintable(manifest.fileName()));
+      return 1;
+    }
+    QDir dir = QFileInfo(manifest.fileName()).dir();
+    QStringList lines = QString::fromUtf8(manifest.readAll()).split("\n");
+    int numCases = 0, numFailed = 0;
+    for (int idx=0; idx<lines.size(); idx++)
+    {
+      QString line = lines.at(idx).trimmed();
+      if (line.isEmpty() || line.startsWith("#"))
+        continue;
+      numCases++;
+      if (!checkCase(app, dir, line, args.value(limitOpt).toInt()))
+        numFailed++;
+    }
+    fprintf(stderr, "%d of %d cases failed\n", numFailed, numCases);
+    passed = (numFailed == 0);
+  }
+
+  if (args.isSet(scalingOpt) || args.isSet(checkOpt))
+    sizes.clear(); // that was all
+
+  for (int idx=0; idx<sizes.size(); idx++)
+  {
+    int size = sizes.at(idx).toInt();
+    if (size <= 0)
+    {
+      fprintf(stderr, "Bad size %s\n", qPrintable(sizes.at(idx)));
+      return 1;
+    }
+    if (macro)
+    {
+      fprintf(stderr, "macro %d items\n", size);
+      Phases phases;
+      WantGenType gen;
+      setDefaultWantGen(gen, size);
+      gen.seed = seed;
+      phases.start("generate");
+      QByteArray data = generateWants(gen);
+      phases.stop();
+      runMacro("generated", data, phases, options, args.value(limitOpt).toInt());
+      continue;
+    }
+    benchHeap<PairingHeap>("heap/PAIRING", size, seed, minNsecs, minReps);
+    benchHeap<QuadHeap>("heap/QUAD", size, seed, minNsecs, minReps);
+    benchHeap<RadixHeap>("heap/RADIX", size, seed, minNsecs, minReps);
+    benchHeap<BucketHeap>("heap/BUCKET", size, seed, minNsecs, minReps);
+    benchGraph(size, seed, options, minNsecs, minReps);
+  }
+
+  QString json = "{\n  \"benchmark\": \"tradebench\",\n  \"seed\": " + QString::number(seed)
+                 + ",\n  \"options\": \"" + options.replace("\"", "\\\"") + "\""
+                 + ",\n  \"results\": [\n    " + gResults.join(",\n    ") + "\n  ]\n}\n";
+  QFile out(args.value(outOpt));
+  bool opened;
+  if (args.value(outOpt).isEmpty())
+    opened = out.open(stdout, QIODevice::WriteOnly);
+  else
+    opened = out.open(QIODevice::WriteOnly | QIODevice::Text);
+  if (!opened)
+  {
+    fprintf(stderr, "Could not write %s\n", qPrintable(args.value(outOpt)));
+    return 1;
+  }
+  out.write(json.toUtf8());
+  return passed ? 0 : 1;
+}
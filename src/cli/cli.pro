@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# tradecli: runs the solver from the command line, without a display
+#
+#-------------------------------------------------
+
+QT       += core concurrent
+QT       -= gui
+
+TARGET = tradecli
+TEMPLATE = app
+CONFIG   += console
+CONFIG   -= app_bundle
+
+include(../core.pri) # the solver
+
+SOURCES += main.cpp
@@ -0,0 +1,207 @@
+#include <QCoreApplication>
+#include <QCommandLineParser> // for the arguments
+#include <QFile>              // for file I/O
+#include <QFileInfo>          // for naming the input
+#include <QThreadPool>        // for the thread count
+#include <QRegExp>            // for stripping HTML
+#include <QTimer>             // for acting on Ctrl-C
+#include <stdio.h>            // for writing to stdout and stderr
+#include <signal.h>           // for stopping on Ctrl-C
+#include "exec.h"
+
+static volatile sig_atomic_t gInterrupts = 0; // Ctrl-Cs so far
+static QAtomicInt gKeepRunning(1); // cleared on a second Ctrl-C, to cancel
+static QAtomicInt gPaused(0);      // never set; there's nobody to resume
+
+// Only counts, since hardly anything is safe in a signal handler. The main
+// thread acts on the count (see main()).
+static void interrupt(int)
+{
+  gInterrupts = gInterrupts + 1;
+}
+
+// Follows a run on stderr, and writes the results to stdout or a file
+class CliReporter : public Reporter
+{
+  public:
+    CliReporter(QString outPath, bool html, bool quiet);
+    void setBarFormat(QString fmt, int max);
+    void setBarVal(int) {}
+    void displayTxt(QString) {}
+    void displayStats(QString status, QString users, QString real, QString viable, QString trades, QString iter);
+    void inputError(QString str);
+    void runComplete(QString results);
+
+  private:
+    QString outPath; // or empty for stdout
+    bool html;       // write the results as HTML, as the GUI shows them
+    bool quiet;      // only report errors
+    bool failed;
+    QString lastIter;
+};
+
+
+CliReporter::CliReporter(QString outPath, bool html, bool quiet)
+{
+  this->outPath = outPath;
+  this->html = html;
+  this->quiet = quiet;
+  failed = false;
+}
+
+// Each step of the run starts a new progress bar in the GUI
+void CliReporter::setBarFormat(QString fmt, int max)
+{
+  if (!quiet)
+    fprintf(stderr, "%s (%d)\n", qPrintable(fmt.section(" %", 0, 0)), max);
+}
+
+void CliReporter::displayStats(QString status, QString, QString, QString, QString trades, QString iter)
+{
+  if (!quiet && status == "Running" && iter != lastIter)
+    fprintf(stderr, "  iteration %s, %s trades\n", qPrintable(iter), qPrintable(trades));
+  lastIter = iter;
+}
+
+void CliReporter::inputError(QString str)
+{
+  fprintf(stderr, "Input error: %s\n", qPrintable(str));
+  failed = true;
+}
+
+void CliReporter::runComplete(QString results)
+{
+  // The results are HTML for the GUI. Like saving them from the GUI, keep
+  // just the text unless asked for the HTML.
+  if (!html)
+  {
+    results.remove("<br>"); // each is followed by a newline
+    results.remove(QRegExp("<[^>]*>"));
+  }
+
+  QFile out(outPath);
+  bool opened;
+  if (outPath.isEmpty())
+    opened = out.open(stdout, QIODevice::WriteOnly);
+  else
+    opened = out.open(QIODevice::WriteOnly | QIODevice::Text);
+  if (!opened)
+  {
+    fprintf(stderr, "Could not write %s\n", qPrintable(outPath));
+    failed = true;
+  }
+  else
+    out.write(results.toUtf8());
+  out.close();
+  QCoreApplication::exit(failed || gInterrupts > 0 ? 1 : 0);
+}
+
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("tradecli");
+  QCoreApplication::setApplicationVersion(PROG_VERSION);
+
+  QCommandLineParser args;
+  args.setApplicationDescription(PROG_NAME + " without a display: finds the trades "
+                                 "for a file of want lists. Ctrl-C stops after the "
+                                 "iterations under way and writes the best trades found; "
+                                 "a second Ctrl-C cancels.");
+  args.addHelpOption();
+  args.addVersionOption();
+  args.addPositionalArgument("wants", "The want list file.");
+  QCommandLineOption outOpt(QStringList() << "o" << "output",
+                            "Write the results to <file> instead of stdout.", "file");
+  QCommandLineOption threadsOpt(QStringList() << "t" << "threads",
+                                "Use <n> threads (default: one per core).", "n");
+  QCommandLineOption optionsOpt(QStringList() << "O" << "options",
+                                "Options, as on a #! line, read before the file's "
+                                "own, e.g., \"ITERATIONS=100 SEED=7\".", "options");
+  QCommandLineOption htmlOpt("html", "Write the results as HTML, as the GUI shows them.");
+  QCommandLineOption quietOpt(QStringList() << "q" << "quiet", "Only report errors.");
+  QCommandLineOption profileOpt("profile", "Write the phase times and solver counters to "
+                                "<file> as JSON. Needs a build with CONFIG+=profile.", "file");
+  args.addOption(outOpt);
+  args.addOption(threadsOpt);
+  args.addOption(optionsOpt);
+  args.addOption(htmlOpt);
+  args.addOption(quietOpt);
+  args.addOption(profileOpt);
+  args.process(app);
+  if (args.positionalArguments().size() != 1)
+    args.showHelp(1);
+#ifndef TRADE_PROFILE
+  if (args.isSet(profileOpt))
+  {
+    fprintf(stderr, "--profile needs a build with CONFIG+=profile\n");
+    return 1;
+  }
+#endif
+
+  if (args.isSet(threadsOpt))
+  {
+    bool ok;
+    int numThreads = args.value(threadsOpt).toInt(&ok);
+    if (!ok || numThreads <= 0)
+    {
+      fprintf(stderr, "The thread count must be a positive integer\n");
+      return 1;
+    }
+    QThreadPool::globalInstance()->setMaxThreadCount(numThreads);
+  }
+
+  // Map the want list file, as the GUI does
+  QString path = args.positionalArguments().at(0);
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly))
+  {
+    fprintf(stderr, "Could not open %s\n", qPrintable(path));
+    return 1;
+  }
+  QByteArray data;
+  uchar *ptrMap = (file.size() > 0) ? file.map(0, file.size()) : NULL;
+  if (ptrMap != NULL)
+    data = QByteArray::fromRawData((const char*)ptrMap, file.size());
+  else
+    data = file.readAll(); // can't be mapped, so read it instead
+
+  signal(SIGINT, interrupt);
+  CliReporter reporter(args.value(outOpt), args.isSet(htmlOpt), args.isSet(quietOpt));
+  Exec *ptrExec = new Exec(&reporter);
+
+  // The first Ctrl-C stops early and the second cancels
+  QTimer interruptPoll;
+  int handled = 0;
+  QObject::connect(&interruptPoll, &QTimer::timeout, [&]()
+  {
+    if (gInterrupts == handled)
+      return;
+    handled = gInterrupts;
+    if (handled == 1)
+    {
+      fprintf(stderr, "Stopping early; press Ctrl-C again to cancel\n");
+      ptrExec->stopEarly();
+    }
+    else
+      gKeepRunning.storeRelease(0);
+  });
+  interruptPoll.start(100);
+
+  ptrExec->go(data, QFileInfo(path).fileName(), &gKeepRunning, &gPaused,
+              args.value(optionsOpt));
+  int ret = app.exec();
+  if (args.isSet(profileOpt))
+  {
+    QFile profile(args.value(profileOpt));
+    if (profile.open(QIODevice::WriteOnly | QIODevice::Text))
+      profile.write(ptrExec->profile().json().toUtf8());
+    else
+    {
+      fprintf(stderr, "Could not write %s\n", qPrintable(args.value(profileOpt)));
+      ret = 1;
+    }
+  }
+  delete ptrExec;
+  return ret;
+}
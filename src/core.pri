@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# The solver: parsing, graph building, matching and metrics. It only needs
+# Qt Core, and reports through the Reporter interface, so it's shared by
+# the GUI (Trade.pro) and the command-line tool (cli/cli.pro).
+#
+#-------------------------------------------------
+
+QT       += core concurrent
+
+# qmake CONFIG+=profile builds in the timers and counters for the PROFILE
+# option (see profile.h)
+profile {
+  DEFINES += TRADE_PROFILE
+}
+
+INCLUDEPATH += $$PWD
+DEPENDPATH  += $$PWD
+
+SOURCES += $$PWD/parser.cpp \
+    $$PWD/graph.cpp \
+    $$PWD/heap.cpp \
+    $$PWD/javarand.cpp \
+    $$PWD/exec.cpp \
+    $$PWD/metric.cpp \
+    $$PWD/profile.cpp \
+    $$PWD/symbols.cpp \
+    $$PWD/lexer.cpp
+
+HEADERS += $$PWD/reporter.h \
+    $$PWD/parser.h \
+    $$PWD/graph.h \
+    $$PWD/heap.h \
+    $$PWD/javarand.h \
+    $$PWD/exec.h \
+    $$PWD/metric.h \
+    $$PWD/profile.h \
+    $$PWD/symbols.h \
+    $$PWD/lexer.h
@@ -3,18 +3,34 @@
 #include <QTimer> // for periodically updating threads
 
 extern QHash<QString, OptionType> gOptions;
+extern SettingsType gSettings;
 
 #define PROGRESS_PER_ITER 256  // the resultion of an individual thread for updating progress bar
 
-Exec::Exec(MainWindow *parent)
+Exec::Exec(Reporter *ptrReporter)
 {
-  ptrParent       = parent;
+  this->ptrReporter = ptrReporter;
   ptrBestCycles   = NULL;
   ptrBestGraph    = NULL;
   bestMetric      = 0;
   iterations      = 0;
   completions     = 0;
+  calcMetric      = NULL;
+  debug           = false;
+  bestKey         = ~Q_UINT64_C(0); // anything beats this
+  maxPrepared     = 0;
+  numIterations   = 0;
+  producing       = false;
+  stopping        = false;
+  activeWorkers   = 0;
+  numSolved       = 0;
+  collectPending  = false;
+  pipelineDone    = false;
   bankedTime      = 0;
+  stats.numWorkers        = 0;
+  stats.iterations        = 0;
+  stats.pipelineNsecs     = 0;
+  stats.producerWaitNsecs = 0;
   parsedData.numItems      = 0;
   parsedData.numDummyItems = 0;
   parsedData.maxNameWidth  = 0;
@@ -22,6 +38,11 @@ Exec::Exec(MainWindow *parent)
 
 Exec::~Exec()
 {
+  // Make sure the pipeline has stopped before cleaning up
+  producer.waitForFinished();
+  for (int idx=0; idx<workers.size(); idx++)
+    workers[idx].waitForFinished();
+
   // Clean up
   if (ptrBestCycles)
   {
@@ -31,13 +52,18 @@ Exec::~Exec()
   }
   if (ptrBestGraph != NULL)
       delete ptrBestGraph;
-  while (!graphList.isEmpty())
-    delete graphList.takeFirst();
+  while (!preparedGraphs.isEmpty())
+    delete preparedGraphs.dequeue();
+  while (!finishedGraphs.isEmpty())
+    delete finishedGraphs.takeFirst();
+  while (!finishedCycles.isEmpty())
+    deleteCycles(finishedCycles.takeFirst());
 }
 
 
 // Executes the complete sequence.
-void Exec::go(QString &input, QString inputSrc, bool *ptrRunning, bool *ptrPaused)
+void Exec::go(const QByteArray &input, QString inputSrc, QAtomicInt *ptrRunning,
+              QAtomicInt *ptrPaused, QString extraOptions)
 {
   Q_ASSERT(iterations==0);
 
@@ -47,7 +73,10 @@ void Exec::go(QString &input, QString inputSrc, bool *ptrRunning, bool *ptrPause
   updateStats("Parsing data");
 
   // Read in the want options, usernames, and want lists
-  parseInput(ptrParent, input, parsedData);
+  {
+    PROFILE_PHASE(&profileData, PARSE_PHASE, true);
+    parseInput(ptrReporter, input, parsedData, extraOptions);
+  }
 
   // Display custom options, if they exist
   bool customOptions = false;
@@ -63,7 +92,7 @@ void Exec::go(QString &input, QString inputSrc, bool *ptrRunning, bool *ptrPause
         customOptions = true;
       }
       output += " "+opt.altName.toUpper();
-      if (opt.hasVal && i.key() != "metric")
+      if (opt.hasVal && i.key() != "metric" && i.key() != "heapType")
         output += "="+QString::number(opt.value);
     }
   }
@@ -86,17 +115,26 @@ void Exec::go(QString &input, QString inputSrc, bool *ptrRunning, bool *ptrPause
   // Create the graph by parsing the want lists and other input
   graph.ptrKeepRunning = ptrRunning;
   graph.ptrPaused = ptrPaused;
-  buildGraph(ptrParent, parsedData, graph);
+  graph.heapType = (HEAP_TYPE)gOptions["heapType"].value;
+  graph.lazyDijkstra = gOptions["lazyDijkstra"].enabled;
+  graph.multiAugment = gOptions["multiAugment"].enabled;
+  graph.splitComponents = gOptions["splitComponents"].enabled;
+  {
+    PROFILE_PHASE(&profileData, BUILD_PHASE, true);
+    buildGraph(ptrReporter, parsedData, graph);
+  }
   jrand.setSeed(gOptions["randSeed"].value);
 
   // Display more info if requested by options
   if (gOptions["showMissing"].enabled && !parsedData.officialNames.isEmpty())
   {
-    for (int idx=0; idx<parsedData.usedNames.size(); idx++)
-      parsedData.officialNames.removeOne(parsedData.usedNames.at(idx));
-    parsedData.officialNames.sort();
+    QStringList missingNames;
     for (int idx=0; idx<parsedData.officialNames.size(); idx++)
-      OUTRED("**** Missing want list for official name " + parsedData.officialNames.at(idx));
+      if (!parsedData.usedNames.contains(parsedData.officialNames.at(idx)))
+        missingNames.append(parsedData.officialNames.at(idx));
+    missingNames.sort();
+    for (int idx=0; idx<missingNames.size(); idx++)
+      OUTRED("**** Missing want list for official name " + missingNames.at(idx));
     OUT();
   }
   if (gOptions["showErrors"].enabled && !parsedData.errors.isEmpty())
@@ -114,110 +152,328 @@ void Exec::go(QString &input, QString inputSrc, bool *ptrRunning, bool *ptrPause
   elapsedTime.start();
 
   // Remove unusable entries and edges from the graph
-  graph.removeImpossibleEdges();
+  {
+    PROFILE_PHASE(&profileData, CULL_PHASE, true);
+    graph.removeImpossibleEdges();
+  }
   updateStats("Running", false);
 
-  // Pre-processing complete. Kick off search function.
-  ptrParent->setBarFormat("Finding matches", PROGRESS_PER_ITER*gOptions["iterations"].value );
+  if (gOptions["benchmarkHeaps"].enabled)
+  {
+    // Keep the benchmark out of the reported processing time
+    bankedTime += elapsedTime.elapsed();
+    benchmarkHeaps();
+    elapsedTime.start();
+  }
+
+  // Pre-processing complete. Start the producer, which prepares the
+  // iterations in order, and a worker per pool thread to solve them.
+  numIterations = gSettings.iterations;
+  calcMetric = metricFunction(gSettings.metric);
+  debug = gSettings.debug;
+  int numThreads = QThreadPool::globalInstance()->maxThreadCount();
+  maxPrepared = numThreads + 2; // keep a couple queued up
+  producing = true;
+  activeWorkers = numThreads;
+  stats.numWorkers = numThreads;
+  stats.workerIdleNsecs.fill(0, numThreads);
+  pipelineTime.start();
+  producerPool.setMaxThreadCount(1);
+  producer = QtConcurrent::run(&producerPool, this, &Exec::produce);
+  for (int idx=0; idx<activeWorkers; idx++)
+    workers.append(QtConcurrent::run(this, &Exec::work, idx));
+
+  // Kick off the progress updates
+  ptrReporter->setBarFormat("Finding matches", PROGRESS_PER_ITER*gOptions["iterations"].value );
   QTimer::singleShot(0, this, SLOT(running()) );
 }
 
 
-void Exec::running()
+// The producer stage of the pipeline. It applies the TradeMaximizer-compatible
+// shuffles in order, because the JavaRand stream has to be consumed in order,
+// and queues up a copy of the graph for each iteration. It waits whenever
+// the queue is full, so only a few prepared copies are around at a time.
+void Exec::produce()
 {
-  static int numWaitingThreads = 2; // keep this many threads queued up
-  Graph *ptrNewGraph;
-  int progress = 0, threadsJustFinished = 0;
+  Profile profiled; // added to profileData at the end
+  for (int idx=0; idx<numIterations  &&  graph.ptrKeepRunning->loadAcquire(); idx++)
+  {
+    Graph *ptrNewGraph = new Graph();
+    // Don't shuffle the graph before the first iteration (because TradeMaximizer didn't)
+    if (idx > 0)
+    {
+      PROFILE_PHASE(&profiled, SHUFFLE_PHASE, false);
+      graph.shuffle(jrand);
+    }
+    // Copy the shuffled graph structure to the new one
+    {
+      PROFILE_PHASE(&profiled, COPY_PHASE, false);
+      graph.copy(ptrNewGraph);
+    }
+
+    QMutexLocker locker(&pipeLock);
+    if (preparedGraphs.size() >= maxPrepared)
+    {
+      QElapsedTimer waited;
+      waited.start();
+      while (preparedGraphs.size() >= maxPrepared  &&  graph.ptrKeepRunning->loadAcquire()  &&
+             !stopping)
+        queueNotFull.wait(&pipeLock, 100); // check back now and then for a cancel
+      stats.producerWaitNsecs += waited.nsecsElapsed();
+    }
+    if (stopping)
+    {
+      delete ptrNewGraph;
+      break;
+    }
+    preparedGraphs.enqueue(ptrNewGraph);
+    iterations++;
+    queueNotEmpty.wakeOne();
+  }
+
+  QMutexLocker locker(&pipeLock);
+  producing = false;
+  PROFILE_ADD(profileData, profiled);
+  queueNotEmpty.wakeAll(); // let idle workers know they're done
+}
 
-  // Check for completions
-  for (int idx=0; idx<runningGraphs.size(); idx++)
+
+// The worker stage of the pipeline. It solves prepared graphs until the
+// producer is done and the queue is empty. It also scores each result, so
+// only the ones that improve on the best so far are left for collect(),
+// which it schedules on the GUI thread.
+void Exec::work(int worker)
+{
+  Profile profiled; // added to profileData when the worker returns
+  QMutexLocker locker(&pipeLock);
+  forever
   {
-    if (!runningGraphs.at(idx).isRunning()) // it finished running
+    if (preparedGraphs.isEmpty()  &&  producing)
     {
-      threadsJustFinished++;
-      if (*graph.ptrKeepRunning)
-        completions++;
-      updateStats("Running", false);
-      if (ptrBestGraph == NULL) // this is the first result!
+      QElapsedTimer waited;
+      waited.start();
+      while (preparedGraphs.isEmpty()  &&  producing)
+        queueNotEmpty.wait(&pipeLock);
+      stats.workerIdleNsecs[worker] += waited.nsecsElapsed();
+    }
+    if (preparedGraphs.isEmpty())
+    {
+      // All iterations have been taken. The last worker out lets collect()
+      // know that the pipeline is done.
+      PROFILE_ADD(profileData, profiled);
+      if (--activeWorkers == 0)
       {
-        ptrBestGraph = graphList.at(idx);
-        ptrBestCycles = runningGraphs.at(idx).result();
-        bestMetric = calculateMetric(ptrBestCycles, (METRIC_TYPE)gOptions["metric"].value);
-        OUTGREEN(metricString((METRIC_TYPE)gOptions["metric"].value));
+        stats.pipelineNsecs = pipelineTime.nsecsElapsed();
+        stats.iterations = numSolved;
+        QMetaObject::invokeMethod(this, "collect", Qt::QueuedConnection);
+      }
+      return;
+    }
+
+    Graph *ptrGraph = preparedGraphs.dequeue();
+    graphList.append(ptrGraph);
+    queueNotFull.wakeOne();
+
+    locker.unlock();
+    CyclesType *ptrCycles;
+    {
+      PROFILE_PHASE(&profiled, FIND_CYCLES_PHASE, false);
+      ptrCycles = ptrGraph->findCycles();
+    }
+    PROFILE_ADD(profiled.counters, ptrGraph->counters);
+    QString metString;
+    int metric = 0;
+    bool improved = false;
+    if (ptrCycles != NULL) // not canceled
+    {
+      PROFILE_PHASE(&profiled, METRIC_PHASE, false);
+      metric = calcMetric(ptrCycles, NULL);
+      improved = publishBest(metric, ptrGraph->numCopies);
+      if (improved || debug)
+        calcMetric(ptrCycles, &metString); // only describe what's reported
+    }
+    locker.relock();
+
+    graphList.removeOne(ptrGraph);
+    if (graph.ptrKeepRunning->loadAcquire())
+      numSolved++;
+    bool report = improved || (debug && ptrCycles != NULL);
+    // Only schedule collect() if one isn't already pending
+    if (report && !collectPending)
+    {
+      collectPending = true;
+      QMetaObject::invokeMethod(this, "collect", Qt::QueuedConnection);
+    }
+    if (improved)
+    {
+      finishedGraphs.append(ptrGraph);
+      finishedCycles.append(ptrCycles);
+      finishedMetrics.append(metric);
+      finishedMetStrings.append(metString);
+    }
+    else
+    {
+      if (report)
+        rejectedMetStrings.append(metString);
+      locker.unlock();
+      deleteCycles(ptrCycles);
+      delete ptrGraph;
+      locker.relock();
+    }
+  }
+}
+
+
+// Stops the producer, so the workers only finish the iterations already
+// prepared. Unlike canceling, allDone() still reports the best result.
+void Exec::stopEarly()
+{
+  QMutexLocker locker(&pipeLock);
+  stopping = true;
+  queueNotFull.wakeAll();
+}
+
+
+// Reports how busy the producer and the workers were, for finding out how
+// well a run scales with the number of threads
+PipelineStatsType Exec::pipelineStats()
+{
+  QMutexLocker locker(&pipeLock);
+  return stats;
+}
+
+
+// Reports where the run's time went and what the solver did (see profile.h)
+Profile Exec::profile()
+{
+  QMutexLocker locker(&pipeLock);
+  return profileData;
+}
+
+
+// Records a worker's result as the best so far if it beats the current
+// best: a lower metric, or the same metric from an earlier iteration (so the
+// winner doesn't depend on the order the workers finish in). Both are
+// packed into one number, with the metric's sign bit flipped so it compares
+// unsigned, letting the workers race on it without a lock.
+bool Exec::publishBest(int metric, int numCopies)
+{
+  quint64 key = ((quint64)((quint32)metric ^ 0x80000000u) << 32) | (quint32)numCopies;
+  forever
+  {
+    quint64 best = bestKey.loadAcquire();
+    if (key >= best)
+      return false;
+    if (bestKey.testAndSetOrdered(best, key))
+      return true;
+  }
+}
+
+
+// Runs on the GUI thread as soon as workers have found improvements. It
+// keeps the best result and wraps up when the pipeline is done.
+void Exec::collect()
+{
+  if (pipelineDone)
+    return; // already wrapped up
+
+  // Take the completed iterations, noting whether they are the last ones
+  pipeLock.lock();
+  QList< Graph* > doneGraphs = finishedGraphs;
+  QList< CyclesType* > doneCycles = finishedCycles;
+  QList< int > doneMetrics = finishedMetrics;
+  QStringList doneMetStrings = finishedMetStrings;
+  QStringList rejected = rejectedMetStrings;
+  finishedGraphs.clear();
+  finishedCycles.clear();
+  finishedMetrics.clear();
+  finishedMetStrings.clear();
+  rejectedMetStrings.clear();
+  collectPending = false;
+  completions = numSolved;
+  pipelineDone = (activeWorkers == 0);
+  pipeLock.unlock();
+
+  updateStats("Running", false);
+  for (int idx=0; idx<rejected.size(); idx++)
+    OUT("# " + rejected.at(idx));
+
+  // Workers can publish improvements faster than they get here, so they
+  // may still arrive out of order
+  for (int idx=0; idx<doneGraphs.size(); idx++)
+  {
+    Graph *ptrGraph = doneGraphs.at(idx);
+    CyclesType *ptrCycles = doneCycles.at(idx);
+    if (ptrBestGraph == NULL) // this is the first result!
+    {
+      ptrBestGraph = ptrGraph;
+      ptrBestCycles = ptrCycles;
+      bestMetric = doneMetrics.at(idx);
+      OUTGREEN(doneMetStrings.at(idx));
+      updateStats("Running");
+    }
+    else
+    {
+      int newMetric = doneMetrics.at(idx);
+
+      // Check if we have a new best (or a tie that should have occurred earlier)
+      if (newMetric < bestMetric ||
+          (newMetric == bestMetric  &&  ptrGraph->numCopies < ptrBestGraph->numCopies) )
+      {
+        // Destroy old results
+        deleteCycles(ptrBestCycles);
+        delete ptrBestGraph;
+        // Save off info on the new find
+        bestMetric = newMetric;
+        ptrBestCycles = ptrCycles;
+        ptrBestGraph = ptrGraph;
+        OUTGREEN(doneMetStrings.at(idx));
         updateStats("Running");
       }
       else
       {
-        // Determine if we have a better solution this time
-        CyclesType *ptrCycles = runningGraphs.at(idx).result();
-        int newMetric = calculateMetric(ptrCycles, (METRIC_TYPE)gOptions["metric"].value);
-
-        // Check if we have a new best (or a tie that should have occurred earlier)
-        if (newMetric < bestMetric ||
-            (newMetric == bestMetric  &&  graphList.at(idx)->numCopies < ptrBestGraph->numCopies) )
+        deleteCycles(ptrCycles);
+        delete ptrGraph;
+        if (debug)
         {
-          // Destroy old results
-          deleteCycles(ptrBestCycles);
-          delete ptrBestGraph;
-          // Save off info on the new find
-          bestMetric = newMetric;
-          ptrBestCycles = ptrCycles;
-          ptrBestGraph = graphList.at(idx);
-          OUTGREEN(metricString((METRIC_TYPE)gOptions["metric"].value));
+          OUT("# " + doneMetStrings.at(idx));
           updateStats("Running");
         }
-        else
-        {
-          deleteCycles(ptrCycles);
-          delete graphList[idx];
-          if (gOptions["debug"].enabled)
-          {
-            OUT("# " + metricString((METRIC_TYPE)gOptions["metric"].value));
-            updateStats("Running");
-          }
-        } // end if (better result)
-      } // end if (ptrBestGraph)
-
-      // Remove completed items from lists
-      runningGraphs.removeAt(idx);
-      graphList.removeAt(idx);
-    } // end if (completed)
-  } // end for(runningGraphs)
-
-  // If iterations are finishing faster than we're spawning new threads,
-  // then spawn threads faster.
-  if (threadsJustFinished >= numWaitingThreads)
-    numWaitingThreads = threadsJustFinished + 2;
-
-  // Start new threads if
-  //  * we haven't been canceled AND
-  //  * there are available CPU cores AND
-  //  * we haven't spawned enough to hit our iteration count
-  while (*graph.ptrKeepRunning  &&
-         runningGraphs.size() < QThread::idealThreadCount() + numWaitingThreads &&
-         iterations < gOptions["iterations"].value)
-  {
-    ptrNewGraph = new Graph();
-    // Don't shuffle the graph before the first iteration (because TradeMaximizer didn't)
-    if (iterations++ > 0)
-      graph.shuffle(jrand);
-    // Copy the previous graph structure to the new one.
-    graph.copy(ptrNewGraph);
-    runningGraphs.append( QtConcurrent::run(ptrNewGraph, &Graph::findCycles) );
-    graphList.append(ptrNewGraph);
-  }
+      } // end if (better result)
+    } // end if (ptrBestGraph)
+  } // end for(doneGraphs)
+  if (!rejected.isEmpty())
+    updateStats("Running");
+
+  if (pipelineDone)
+    allDone();
+}
+
+
+// Periodically updates the progress bar and keeps track of pauses
+void Exec::running()
+{
+  int progress = 0;
+
+  if (pipelineDone)
+    return; // no more updates needed
 
   // Update status bar
-  if (*graph.ptrKeepRunning)
+  if (graph.ptrKeepRunning->loadAcquire())
   {
+    pipeLock.lock();
+    completions = numSolved;
     progress = PROGRESS_PER_ITER*completions;
     for (int idx=0; idx<graphList.size(); idx++)
-      progress += graphList.at(idx)->progress;
-    ptrParent->setBarVal(progress);
+      progress += graphList.at(idx)->getProgress();
+    pipeLock.unlock();
+    ptrReporter->setBarVal(progress);
+    if (!graph.ptrPaused->loadAcquire())
+      updateStats("Running", false);
   }
 
   // Pause the timer if we're paused
-  if (*graph.ptrPaused)
+  if (graph.ptrPaused->loadAcquire())
   {
     updateStats("Paused", false);
     if (elapsedTime.isValid())
@@ -226,16 +482,13 @@ void Exec::running()
       elapsedTime.invalidate();
     }
   }
-  else if (!*graph.ptrPaused && !elapsedTime.isValid()) // if we just resumed
+  else if (!graph.ptrPaused->loadAcquire() && !elapsedTime.isValid()) // if we just resumed
   {
     elapsedTime.start();  // start the timer back up
     updateStats("Running", false);
   }
 
-  if (runningGraphs.isEmpty())
-    allDone();
-  else
-    QTimer::singleShot(500, this, SLOT(running()) ); // perform a couple times per second
+  QTimer::singleShot(500, this, SLOT(running()) ); // perform a couple times per second
 }
 
 
@@ -243,18 +496,44 @@ void Exec::allDone()
 {
   OUT();
 
-  if (*graph.ptrKeepRunning)
+  pipeLock.lock();
+  bool stopped = stopping  &&  completions < gSettings.iterations;
+  pipeLock.unlock();
+
+  // A run stopped early still reports its best result, if it got one
+  // before it was stopped (or canceled)
+  if (ptrBestCycles != NULL  &&  (graph.ptrKeepRunning->loadAcquire() || stopped))
   {
     quint64 totalTime = elapsedTime.elapsed() + bankedTime;
-    output += displayMatches(ptrBestCycles, parsedData, ptrBestGraph);
+    if (stopped)
+    {
+      OUTRED("STOPPED EARLY after " + QString::number(completions) + " of " +
+             QString::number(gSettings.iterations) + " iterations.");
+      OUT();
+    }
+    {
+      PROFILE_PHASE(&profileData, OUTPUT_PHASE, true);
+      output += displayMatches(ptrBestCycles, parsedData, ptrBestGraph);
+    }
 
     if (gOptions["showElapsedTime"].enabled)
     {
       output += "Elapsed time = ";
       OUTBLUE(QString::number(totalTime) + "ms ("+timeToStr(totalTime)+")");
     }
-    updateStats("Completed");
-    ptrParent->setBarFormat("Completed", PROGRESS_PER_ITER*gOptions["iterations"].value );
+    if (gOptions["profile"].enabled)
+    {
+#ifdef TRADE_PROFILE
+      // The pipeline phases overlap, so their times are totals over the threads
+      OUT();
+      output += "<pre>PROFILE:\n\n" + profileData.text() + "</pre>\n";
+#else
+      OUTRED("PROFILE needs a build with CONFIG+=profile");
+#endif
+    }
+    updateStats(stopped ? "Stopped" : "Completed");
+    ptrReporter->setBarFormat(stopped ? "Stopped" : "Completed",
+                              PROGRESS_PER_ITER*gOptions["iterations"].value );
   }
   else
   {
@@ -262,7 +541,50 @@ void Exec::allDone()
     updateStats("Canceled");
   }
 
-  ptrParent->runComplete(output);
+  ptrReporter->runComplete(output);
+}
+
+
+// Solves the unshuffled graph once with each priority queue and reports how
+// long each one took. They should all arrive at the same number of trades
+// and total cost, though not necessarily the same trades.
+void Exec::benchmarkHeaps()
+{
+  const char *names[] = { "PAIRING", "QUAD", "RADIX", "BUCKET" };
+  int numCopies = graph.numCopies; // benchmark copies don't count as iterations
+
+  OUT("HEAP BENCHMARK:");
+  for (int type=PAIRING_HEAP; type<=BUCKET_HEAP  &&  graph.ptrKeepRunning->loadAcquire(); type++)
+  {
+    updateStats(QString("Benchmarking ") + names[type], false);
+    Graph benchGraph;
+    graph.copy(&benchGraph);
+    benchGraph.heapType = (HEAP_TYPE)type;
+
+    QElapsedTimer timer;
+    timer.start();
+    CyclesType *ptrCycles = benchGraph.findCycles();
+    quint64 time = timer.elapsed();
+    if (ptrCycles == NULL)
+      break; // canceled
+
+    int numTrades = 0;
+    quint64 totalCost = 0;
+    for (int idx=0; idx<ptrCycles->size(); idx++)
+    {
+      numTrades += ptrCycles->at(idx)->size();
+      for (int j=0; j<ptrCycles->at(idx)->size(); j++)
+        totalCost += ptrCycles->at(idx)->at(j).matchCost;
+    }
+    deleteCycles(ptrCycles);
+
+    output += pad(names[type], 11) + " = ";
+    OUTBLUE(QString::number(time) + "ms (" + QString::number(numTrades) + " trades, total cost "
+            + QString::number(totalCost) + ")");
+    updateStats("Running");
+  }
+  OUT();
+  graph.numCopies = numCopies;
 }
 
 
@@ -301,19 +623,21 @@ QString Exec::displayMatches(CyclesType *ptrCycles,
     for(int i=0; i<ptrCycle->size(); i++)
     {
       Node n = ptrCycle->at(i);
+      Node receiver = ptrCycle->at((i+size-1)%size); // the one receiving n's item
       Q_ASSERT(n.ptrMatch != n.ptrTwin);
       loops.append(pad(n.show(sort),width) + " receives " + n.ptrMatch->ptrTwin->show(sort));
-      summary.append(pad(n.show(sort),width) + " receives " + pad(n.ptrMatch->ptrTwin->show(sort),width) + " and sends to " + n.ptrTwin->ptrMatch->show(sort));
+      summary.append(pad(n.show(sort),width) + " receives " + pad(n.ptrMatch->ptrTwin->show(sort),width) + " and sends to " + receiver.show(sort));
       totalCost += n.matchCost;
     }
     loops.append("");
   }
   if (gOptions["showNonTrades"].enabled)
   {
-    for(int i=0; i<ptrGraph->wanters.size(); i++)
+    QList<Node*> untraded = ptrGraph->untraded();
+    for(int i=0; i<untraded.size(); i++)
     {
-      Node *n = ptrGraph->wanters.at(i);
-      if (n->ptrMatch == n->ptrTwin && !n->isDummy)
+      Node *n = untraded.at(i);
+      if (!n->isDummy)
         summary.append(pad(n->show(sort),width) + "             does not trade");
     }
     for(int i=0; i<ptrGraph->orphans.size(); i++)
@@ -396,10 +720,10 @@ void Exec::updateStats(QString status, bool newOutput)
   QString real = statNum(parsedData.numItems - parsedData.numDummyItems);
   QString viable = statNum(graph.viableRealItems);
   QString iter = QString::number(completions) + " of " +
-                 QString::number(gOptions["iterations"].value);
-  ptrParent->displayStats(status,users,real,viable,trades,iter);
+                 QString::number(gSettings.iterations);
+  ptrReporter->displayStats(status,users,real,viable,trades,iter);
   if (newOutput)
-    ptrParent->displayTxt(output);
+    ptrReporter->displayTxt(output);
 }
 QString Exec::statNum(int x)
 {
@@ -4,11 +4,16 @@
 #include <QString>       // for all the string stuff
 #include <QElapsedTimer> // for displaying execution time
 #include <QtConcurrent>  // for multiple thread execution
-#include "mainwindow.h"
+#include <QMutex>          // for the producer pipeline
+#include <QWaitCondition>  // ditto
+#include <QQueue>          // ditto
+#include <QAtomicInteger>  // for the best result so far
+#include "reporter.h"
 #include "parser.h"
 #include "graph.h"
 #include "javarand.h"
 #include "metric.h"
+#include "profile.h"
 
 #define PROG_NAME     QString("TradeThing")
 #define PROG_VERSION  QString("v1.4")
@@ -19,21 +24,40 @@
 #define OUTGREEN(str)   output += QString("<font color=\"#007000\">")+ QString(str) + "</font>" + NEWLINE
 #define OUTPURPLE(str)  output += QString("<font color=\"#900090\">")+ QString(str) + "</font>" + NEWLINE
 
+// Where the pipeline's time went (see Exec::pipelineStats())
+typedef struct
+{
+  int numWorkers;
+  unsigned int iterations;          // iterations the workers solved
+  qint64 pipelineNsecs;             // from starting the pipeline until the last worker finished
+  qint64 producerWaitNsecs;         // time the producer waited for room in the queue
+  QVector<qint64> workerIdleNsecs;  // time each worker waited for a prepared graph
+} PipelineStatsType;
+
 class Exec: public QObject
 {
   Q_OBJECT  // allow slots
 
   public:
-    Exec(MainWindow *parent);
+    Exec(Reporter *ptrReporter);
     ~Exec();
-    void go(QString &input, QString inputSrc, bool *ptrRunning, bool *ptrPaused);
+    void go(const QByteArray &input, QString inputSrc, QAtomicInt *ptrRunning,
+            QAtomicInt *ptrPaused, QString extraOptions=QString());
+    void stopEarly(); // prepare no more iterations, but report the best so far
+    PipelineStatsType pipelineStats(); // once the run is complete
+    Profile profile();                 // ditto; empty unless built with CONFIG+=profile
 
   private slots:
+    void collect();
     void running();
 
 
   private:
     void allDone();
+    void benchmarkHeaps();
+    void produce();
+    void work(int worker);
+    bool publishBest(int metric, int numCopies);
     void deleteCycles(CyclesType *ptrCycles);
     QString displayMatches(CyclesType *ptrCycles, ParseDataType parsed, Graph *ptrGraph);
     void updateStats(QString status, bool newOutput=true);
@@ -41,7 +65,7 @@ class Exec: public QObject
     QString pad(QString name, int width);
     QString timeToStr(quint64 t);
 
-    MainWindow *ptrParent;
+    Reporter *ptrReporter;
     ParseDataType parsedData;
     QString output;
     Graph graph;
@@ -51,11 +75,38 @@ class Exec: public QObject
     CyclesType *ptrBestCycles;
     Graph *ptrBestGraph;
     int bestMetric;
-    unsigned int iterations; // how many iterations have been started
+    unsigned int iterations; // how many iterations have been prepared
     unsigned int completions; // how many iterations have been completed
+    MetricFunction calcMetric; // for the workers (see metricFunction())
+    bool debug;                // gSettings copy for the workers
+    QAtomicInteger<quint64> bestKey; // best result published by the workers (see publishBest())
 
-    QList< QFuture<CyclesType*> > runningGraphs;
-    QList< Graph* > graphList;
+    // The producer pipeline (see produce() and work()). Everything below is
+    // guarded by pipeLock, except for the futures, which only the GUI thread uses.
+    QMutex pipeLock;
+    QWaitCondition queueNotFull;    // signaled when a worker takes a graph
+    QWaitCondition queueNotEmpty;   // signaled when the producer adds one
+    QQueue< Graph* > preparedGraphs; // shuffled copies waiting for a worker
+    int maxPrepared;                 // capacity of preparedGraphs
+    int numIterations;               // how many iterations to prepare
+    bool producing;                  // the producer has more to prepare
+    bool stopping;                   // stopEarly() was called
+    int activeWorkers;               // workers that haven't returned yet
+    unsigned int numSolved;          // iterations the workers have completed
+    bool collectPending;             // collect() has been scheduled
+    QList< Graph* > graphList;       // graphs being solved by the workers
+    QList< Graph* > finishedGraphs;  // improved results not yet collected...
+    QList< CyclesType* > finishedCycles; // ...their cycles...
+    QList< int > finishedMetrics;        // ...their metrics...
+    QStringList finishedMetStrings;      // ...and descriptions
+    QStringList rejectedMetStrings;  // results that weren't improvements (DEBUG only)
+    QThreadPool producerPool;        // keeps the producer off the worker threads
+    QFuture<void> producer;
+    QList< QFuture<void> > workers;
+    bool pipelineDone; // collect() has taken the last results (GUI thread only)
+    QElapsedTimer pipelineTime; // since the pipeline started
+    PipelineStatsType stats;    // guarded by pipeLock
+    Profile profileData;        // guarded by pipeLock while the pipeline runs
 };
 
 
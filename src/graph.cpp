@@ -1,36 +1,28 @@
 #include "graph.h"
 #include "javarand.h"
 #include <QThread> // for delaying during a pause
+#include <QtConcurrent> // for solving components concurrently and finding them
+#include <QHash> // for grouping component members
+#include <algorithm> // for std::stable_sort
 
 #define INFINITY   100000000000000ULL       // (10^14)
 
-Node::Node(QString name, QString owner, bool isDummy, DirectionEnum type)
+extern SymbolTable gSymbols;
+
+static QAtomicInt gNoFlag; // stands in for the flags until the graph is given them
+
+Node::Node(int nameId, int ownerId, bool isDummy, DirectionEnum type)
 {
-  this->name     = name;
-  this->owner    = owner;
+  this->nameId   = nameId;
+  this->ownerId  = ownerId;
   this->isDummy  = isDummy;
   this->type     = type;
   ptrTwin        = NULL;
   ptrMatch       = NULL;
-  ptrFrom        = NULL;
   matchCost      = 0;
-  mark           = 0;
-  price          = 0;
   component      = 0;
   minimumInCost  = MAX_VALUE;
-  ptrHeapEntry   = NULL;
-}
-
-
-// Returns true if this node contains an edge to SENDS-node ptrToNode
-// This function replaces getEdge() from TradeMaximizer
-bool Node::containsEdge(Node *ptrToNode)
-{
-  int idx;
-  for (idx=0; idx<edges.size(); idx++)
-    if (edges.at(idx)->ptrSender == ptrToNode)
-      return true;
-  return false;
+  id             = NO_NODE;
 }
 
 
@@ -53,11 +45,23 @@ Graph::Graph()
   timestamp = 0;
   component = 0;
   numCopies = 0;
-  progress  = 0;
+  progress.store(0);
+  heapType  = PAIRING_HEAP;
+  lazyDijkstra = false;
+  multiAugment = false;
+  splitComponents = false;
+  ptrWhole = NULL;
+  reportedMatched = 0;
+  reordered = false;
+  solved = false;
+  numSettled = 0;
+  numSources = 0;
+  searchStamp = 0;
   viableRealItems = 0;
-  ptrSinkFrom = NULL;
-  ptrKeepRunning = (bool*)&timestamp; // temporary non-null assignment
-  ptrPaused = ptrKeepRunning; // ditto
+  numWanters = 0;
+  sinkFrom = NO_NODE;
+  ptrKeepRunning = &gNoFlag; // temporary non-null assignment
+  ptrPaused = &gNoFlag; // ditto
 }
 
 Graph::~Graph()
@@ -79,23 +83,26 @@ Graph::~Graph()
     delete orphans[i];
 }
 
-Node* Graph::getNode(QString name)
+Node* Graph::getNode(int nameId)
 {
-  return nameMap.value(name, NULL);  // returns NULL if name isn't in nameMap
+  // returns NULL if name isn't in nameMap (or was never interned)
+  return nameMap.value(nameId, NULL);
 }
 
 
 // Returns a pointer to wanter node
-Node* Graph::addNode(QString name, QString owner, bool isDummy)
+Node* Graph::addNode(int nameId, int ownerId, bool isDummy)
 {
   Q_ASSERT(!frozen); // nothing should be added to a graph once it is frozen
-  Q_ASSERT(!nameMap.contains(name)); // make sure this name is unique
+  Q_ASSERT(getNode(nameId) == NULL); // make sure this name is unique
 
-  Node *ptrWanter = new Node(name, owner, isDummy, WANTS);
+  Node *ptrWanter = new Node(nameId, ownerId, isDummy, WANTS);
   wanters.append(ptrWanter);
-  nameMap.insert(name,ptrWanter);
+  if (nameId >= nameMap.size())
+    nameMap.resize(nameId+1);
+  nameMap[nameId] = ptrWanter;
 
-  Node *ptrSender = new Node(name+" sender", owner, isDummy, SENDS);
+  Node *ptrSender = new Node(nameId, ownerId, isDummy, SENDS);
   senders.append(ptrSender);
   ptrWanter->ptrTwin = ptrSender;
   ptrSender->ptrTwin = ptrWanter;
@@ -112,80 +119,329 @@ void Graph::addEdge(Node *ptrWanter, Node *ptrSender, quint64 cost)
   Edge *edge = new Edge(ptrWanter, ptrSender, cost);
   ptrWanter->edges.append(edge);
   ptrSender->edges.append(edge);
-  // Don't bother checking if the sending node has a lower minimum cost
-  // right now. It will be recalculated anyway after removing edges later.
-  // !@#
-  // Check if the SENDER node now has a lower minimum cost
-  for (int j=0; j<ptrSender->edges.size(); j++)
-    if (ptrSender->edges.at(j)->cost < ptrSender->minimumInCost)
-      ptrSender->minimumInCost = ptrSender->edges.at(j)->cost;
+  // Check if the SENDER node now has a lower minimum cost. It's recalculated
+  // anyway after removing edges later, so only the new edge needs checking.
+  if (cost < ptrSender->minimumInCost)
+    ptrSender->minimumInCost = cost;
 }
 
 
 // The graph can be "frozen" from adding new elements.
 // TradeMaximizer took advantage of this step by converting its lists
-// to arrays, which were better for its iteration speed.
+// to arrays, which were better for its iteration speed. We go a step further
+// and compile the nodes and edges into the flat layout used by the solver.
 void Graph::freeze()
 {
   Q_ASSERT(!frozen); // make sure we're not freezing it twice
   frozen = true;
+  compile();
 }
 
 
-void Graph::visitWanters(Node *ptrWanter)
+// Number the nodes and lay out their edges in the flat solver arrays.
+// The layout follows the current order of the wanters and senders lists and
+// of each wanter's edges, which is what keeps the results compatible with
+// TradeMaximizer. It has to be rebuilt whenever those lists change.
+void Graph::compile()
 {
-  Q_ASSERT(ptrWanter->type == WANTS);
-  // Mark this wanter as visited
-  ptrWanter->mark = timestamp;
-  // Visit all the wanters of this wanter
-  for (int idx=0; idx<ptrWanter->edges.size(); idx++)
+  int n = wanters.size();
+  Q_ASSERT(senders.size() == n); // nodes always come in wanter-sender pairs
+
+  numWanters = n;
+  nodeAt.resize(2*n);
+  for (int idx=0; idx<n; idx++)
+  {
+    wanters.at(idx)->id = idx;
+    nodeAt[idx] = wanters.at(idx);
+    senders.at(idx)->id = n+idx;
+    nodeAt[n+idx] = senders.at(idx);
+  }
+
+  int numArcs = 0;
+  for (int idx=0; idx<2*n; idx++)
+    numArcs += nodeAt.at(idx)->edges.size();
+  arcStart.resize(2*n+1);
+  arcHead.resize(numArcs);
+  arcCost.resize(numArcs);
+
+  int arc = 0;
+  for (int idx=0; idx<2*n; idx++)
   {
-    Node *ptrNode = ptrWanter->edges.at(idx)->ptrSender->ptrTwin;
-    if (ptrNode->mark != timestamp)
-      visitWanters(ptrNode);
+    Node *ptrNode = nodeAt.at(idx);
+    arcStart[idx] = arc;
+    for (int j=0; j<ptrNode->edges.size(); j++, arc++)
+    {
+      Edge *e = ptrNode->edges.at(j);
+      arcHead[arc] = (ptrNode->type == WANTS) ? e->ptrSender->id : e->ptrWanter->id;
+      arcCost[arc] = e->cost;
+    }
   }
-  // Add the twin (the sender) node to the queue for visitSenders()
-  finished.append(ptrWanter->ptrTwin);
+  arcStart[2*n] = arc;
+
+  twinOf.resize(2*n);
+  for (int id=0; id<2*n; id++)
+    twinOf[id] = nodeAt.at(id)->ptrTwin->id;
+
+  // The layout is now in the current order
+  wanterOrder.resize(n);
+  for (int idx=0; idx<n; idx++)
+    wanterOrder[idx] = idx;
+  arcOrder.resize(numArcs);
+  for (int idx=0; idx<numArcs; idx++)
+    arcOrder[idx] = idx;
+  reordered = false;
 }
-void Graph::visitSenders(Node *ptrSender)
+
+
+// Rebuilds the flat solver layout in the order left by shuffle(). Copies
+// share the layout with the graph they were made from, so this gives them
+// vectors of their own and leaves the shared ones untouched.
+void Graph::layOut()
 {
-  Q_ASSERT(ptrSender->type == SENDS);
-  ptrSender->mark = timestamp; // mark this sender as visited
-  // Visit all the senders of this sender
-  for (int idx=0; idx<ptrSender->edges.size(); idx++)
+  if (!reordered)
+    return;
+
+  int n = numWanters;
+  int numArcs = arcHead.size();
+  QVector<int> slot(n); // wanter id in the current layout -> its new id
+  for (int idx=0; idx<n; idx++)
+    slot[wanterOrder.at(idx)] = idx;
+
+  QVector<Node*> newNodeAt(2*n);
+  QVector<int> newTwinOf(2*n);
+  QVector<int> newStart(2*n+1);
+  QVector<int> newHead(numArcs);
+  QVector<quint64> newCost(numArcs);
+  int arc = 0;
+  for (int idx=0; idx<n; idx++)
   {
-    Node *ptrNode = ptrSender->edges.at(idx)->ptrWanter->ptrTwin;
-    if (ptrNode->mark != timestamp)
-      visitSenders(ptrNode);
+    // The wanters and their arcs move, but the senders they lead to don't
+    int id = wanterOrder.at(idx);
+    newNodeAt[idx] = nodeAt.at(id);
+    newTwinOf[idx] = twinOf.at(id);
+    newStart[idx] = arc;
+    for (int pos=arcStart.at(id); pos<arcStart.at(id+1); pos++, arc++)
+    {
+      newHead[arc] = arcHead.at(arcOrder.at(pos));
+      newCost[arc] = arcCost.at(arcOrder.at(pos));
+    }
+  }
+  for (int id=n; id<2*n; id++)
+  {
+    // The senders stay put, but the wanters their arcs lead to are renumbered
+    newNodeAt[id] = nodeAt.at(id);
+    newTwinOf[id] = slot.at(twinOf.at(id));
+    newStart[id] = arc;
+    for (int pos=arcStart.at(id); pos<arcStart.at(id+1); pos++, arc++)
+    {
+      newHead[arc] = slot.at(arcHead.at(pos));
+      newCost[arc] = arcCost.at(pos);
+    }
   }
-  // Mark both this sender and its twin (wanter) with the current
-  // "component" iteration number, a sort of generational code
-  // to differentiate groups that never want each other.
-  ptrSender->component = ptrSender->ptrTwin->component = component;
+  newStart[2*n] = arc;
+
+  nodeAt = newNodeAt;
+  twinOf = newTwinOf;
+  arcStart = newStart;
+  arcHead = newHead;
+  arcCost = newCost;
+  for (int idx=0; idx<n; idx++)
+    wanterOrder[idx] = idx;
+  for (int idx=0; idx<numArcs; idx++)
+    arcOrder[idx] = idx;
+  reordered = false;
 }
 
-// Traverses edges and removes entries whose sender/wanter pair have
-// unequal component numbers, which indicates they aren't strongly connected
-void Node::removeBadEdges(QList<Edge*> edgeDelQueue)
+
+// Labels every node with the strongly connected component it belongs to.
+// Items are the vertices here: item A points at item B when A's wanter has an
+// edge to B's sender. Large graphs first take out the component containing a
+// well-connected pivot, which in want lists is nearly always the giant one,
+// by intersecting the items reachable from it forwards and backwards. The two
+// searches run concurrently. Every other component then lies entirely inside
+// one of three parts (reached only forwards, only backwards, or neither), so
+// those parts are searched concurrently as well.
+void Graph::findComponents()
+{
+  int n = numWanters;
+
+  partOf.fill(NO_PART, n);
+  compOf.fill(0, n);
+  dfsIndex.fill(0, n);
+  dfsLow.fill(0, n);
+
+  int numParts = 1;
+  if (n >= SCC_PARALLEL_ITEMS)
+  {
+    // Pick the item with the most paths through it as the pivot
+    int pivot = 0;
+    quint64 best = 0;
+    for (int id=0; id<n; id++)
+    {
+      quint64 paths = (quint64)(arcStart.at(id+1) - arcStart.at(id)) *
+                      (arcStart.at(twinOf.at(id)+1) - arcStart.at(twinOf.at(id)));
+      if (paths > best)
+      {
+        best = paths;
+        pivot = id;
+      }
+    }
+
+    QVector<char> forward(n, 0), backward(n, 0);
+    QFuture<void> search = QtConcurrent::run(this, &Graph::markReachable, pivot, true, &forward);
+    markReachable(pivot, false, &backward);
+    search.waitForFinished();
+
+    component++; // the pivot's component
+    for (int id=0; id<n; id++)
+    {
+      if (forward.at(id) && backward.at(id))
+        compOf[id] = component;
+      else
+        partOf[id] = forward.at(id) ? 0 : (backward.at(id) ? 1 : 2);
+    }
+    numParts = 3;
+  }
+  else
+    partOf.fill(0, n);
+
+  // Find the remaining components of each part. The parts share no nodes, so
+  // their searches only write to their own elements of the vectors.
+  QVector<int> numFound(numParts, 0);
+  QList< QFuture<void> > searches;
+  for (int part=1; part<numParts; part++)
+    searches.append(QtConcurrent::run(this, &Graph::labelComponents, part, &numFound[part]));
+  labelComponents(0, &numFound[0]);
+  for (int idx=0; idx<searches.size(); idx++)
+    searches[idx].waitForFinished();
+
+  // Give the parts' components distinct numbers and label both halves of
+  // every item with them
+  QVector<unsigned int> base(numParts);
+  for (int part=0; part<numParts; part++)
+  {
+    base[part] = component;
+    component += numFound.at(part);
+  }
+  for (int id=0; id<n; id++)
+  {
+    unsigned int label = compOf.at(id);
+    if (partOf.at(id) != NO_PART)
+      label += base.at(partOf.at(id));
+    nodeAt.at(id)->component = nodeAt.at(twinOf.at(id))->component = label;
+  }
+}
+
+// Marks the items reachable from the pivot, following the wants forwards or
+// backwards, using a breadth-first search
+void Graph::markReachable(int pivot, bool forward, QVector<char> *ptrSeen)
 {
-  // Remove edges with unequal component numbers
-  for (int idx=edges.size()-1; idx>=0; idx--)
+  QVector<int> queue;
+  queue.reserve(numWanters);
+  queue.append(pivot);
+  (*ptrSeen)[pivot] = 1;
+  for (int head=0; head<queue.size()  &&  ptrKeepRunning->loadAcquire(); head++)
   {
-    if (edges.at(idx)->ptrWanter->component != edges.at(idx)->ptrSender->component)
+    // A wanter's arcs lead to the items it wants; its sender's arcs lead to
+    // the items wanting it
+    int id = forward ? queue.at(head) : twinOf.at(queue.at(head));
+    for (int arc=arcStart.at(id); arc<arcStart.at(id+1); arc++)
     {
-      if (!edgeDelQueue.contains(edges.at(idx)))
-        edgeDelQueue.append(edges.at(idx));
-      edges.removeAt(idx);
+      int next = forward ? twinOf.at(arcHead.at(arc)) : arcHead.at(arc);
+      if (!ptrSeen->at(next))
+      {
+        (*ptrSeen)[next] = 1;
+        queue.append(next);
+      }
     }
   }
 }
 
+// Numbers the components within one part from 1 up, using Tarjan's algorithm
+// with an explicit stack so long want chains can't overflow the call stack.
+// Items outside the part, and items already given a component, are skipped.
+void Graph::labelComponents(int part, int *ptrCount)
+{
+  QVector<int> path;    // the depth-first path, with the next arc of each item
+  QVector<int> nextArc;
+  QVector<int> open;    // visited items not yet assigned a component
+  int counter = 0;
+
+  for (int root=0; root<numWanters  &&  ptrKeepRunning->loadAcquire(); root++)
+  {
+    if (partOf.at(root) != part || dfsIndex.at(root) != 0)
+      continue;
+    dfsIndex[root] = dfsLow[root] = ++counter;
+    open.append(root);
+    path.append(root);
+    nextArc.append(arcStart.at(root));
+
+    while (!path.isEmpty())
+    {
+      int id = path.last();
+      if (nextArc.last() < arcStart.at(id+1))
+      {
+        int next = twinOf.at(arcHead.at(nextArc.last()++));
+        if (partOf.at(next) != part || compOf.at(next) != 0)
+          continue; // in another part or an already finished component
+        if (dfsIndex.at(next) == 0)
+        {
+          dfsIndex[next] = dfsLow[next] = ++counter;
+          open.append(next);
+          path.append(next);
+          nextArc.append(arcStart.at(next));
+        }
+        else if (dfsIndex.at(next) < dfsLow.at(id))
+          dfsLow[id] = dfsIndex.at(next); // still open, so on the stack
+        continue;
+      }
+
+      // All of this item's wants are explored
+      path.removeLast();
+      nextArc.removeLast();
+      if (!path.isEmpty() && dfsLow.at(id) < dfsLow.at(path.last()))
+        dfsLow[path.last()] = dfsLow.at(id);
+      if (dfsLow.at(id) == dfsIndex.at(id))
+      {
+        // It is the root of a component, which is everything opened since
+        (*ptrCount)++;
+        int member;
+        do
+        {
+          member = open.takeLast();
+          compOf[member] = *ptrCount;
+        } while (member != id);
+      }
+    }
+  }
+}
+
+// Traverses edges and removes entries whose sender/wanter pair have
+// unequal component numbers, which indicates they aren't strongly connected
+void Node::removeBadEdges(QList<Edge*> *ptrCulled)
+{
+  // Keep edges with equal component numbers, compacting them in place
+  int kept = 0;
+  for (int idx=0; idx<edges.size(); idx++)
+  {
+    Edge *e = edges.at(idx);
+    if (e->ptrWanter->component == e->ptrSender->component)
+      edges[kept++] = e;
+    else if (ptrCulled != NULL)
+      ptrCulled->append(e);
+  }
+  while (edges.size() > kept)
+    edges.removeLast();
+}
+
 
 // Returns the node's name for displaying results
 QString Node::show(bool sortByItem)
 {
-  if (owner.isEmpty() || isDummy)
+  const QString &name = gSymbols.at(nameId);
+  if (ownerId == EMPTY_SYMBOL || isDummy)
     return name;
+  const QString &owner = gSymbols.at(ownerId);
   if (sortByItem)
     return name + " " + owner;
   return owner + " " + name;
@@ -196,39 +452,24 @@ QString Node::show(bool sortByItem)
 void Graph::removeImpossibleEdges()
 {
   Q_ASSERT(frozen); // the graph should only be cleaned up once we are done adding things
-  QList<Edge*> edgeDelQueue; // queue up edges to be deleted
-
-  // We use the timestamp to flag items as visited. It needs to be advanced from
-  // its default value of zero, which is also the unvisited flag value.
-  timestamp++;
-  finished.clear();
-
-  // We use Kosaraju's algorithm to determine which comopnents are strongly connected.
-  // Strongly connected means every node is reachable from every other node.
-
-  // The first loop determines the order for the second loop by placing nodes
-  // in "finished" in the order that they point towards each other
-  for (int idx=0; idx<wanters.size()  &&  *ptrKeepRunning; idx++)
-    if (wanters.at(idx)->mark != timestamp)
-      visitWanters(wanters.at(idx));
-  // Iterate the list of senders is reverse order such that they point
-  // in the direction in which we are now traversing the graph
-  for (int idx=finished.size()-1; idx>=0; idx--)
-  {
-    if (finished.at(idx)->mark != timestamp)
-    {
-      component++; // increment the strongly connected iteration count
-      visitSenders(finished.at(idx)); // visit the next group of senders
-    }
-  }
-
-  // Now remove all edges between two different component counts
-  for (int idx=0; idx<wanters.size()  &&  *ptrKeepRunning; idx++)
-    wanters.at(idx)->removeBadEdges(edgeDelQueue);
-  for (int idx=0; idx<senders.size()  &&  *ptrKeepRunning; idx++)
+  QList<Edge*> culled; // edges to be deleted
+
+  // Determine which components are strongly connected. Strongly connected
+  // means every node is reachable from every other node.
+  findComponents();
+  if (!ptrKeepRunning->loadAcquire())
+    return; // the components may be incomplete, so leave the edges alone
+
+  // Now remove all edges between two different component counts. Every edge
+  // is in exactly one wanter's list, so only the wanters collect them. This
+  // and the rest take linear time, so they are not interrupted: the culled
+  // edges must be gone from every list before they can be deleted.
+  for (int idx=0; idx<wanters.size(); idx++)
+    wanters.at(idx)->removeBadEdges(&culled);
+  for (int idx=0; idx<senders.size(); idx++)
   {
     Node *ptrNode = senders.at(idx);
-    ptrNode->removeBadEdges(edgeDelQueue);
+    ptrNode->removeBadEdges(NULL);
 
     // Calculate the lowest incoming cost
     ptrNode->minimumInCost = MAX_VALUE;
@@ -239,125 +480,677 @@ void Graph::removeImpossibleEdges()
 
   // Remove orphaned items, which are items no longer wanted by anybody
   // after culling bad edges. (It's not as sad as it sounds.)
-  removeOrphans(edgeDelQueue);
+  removeOrphans(&culled);
 
   // Delete allocated memory associated with culled edges
-  while(!edgeDelQueue.isEmpty())
-    delete edgeDelQueue.takeFirst();
+  qDeleteAll(culled);
+
+  // The surviving nodes and edges need a fresh solver layout
+  compile();
 }
 
-// Cull nodes that have no edges, except to themselves (wanter-sender pair)
-void Graph::removeOrphans(QList<Edge*> edgeDelQueue)
+// Cull nodes that have no edges, except to themselves (wanter-sender pair).
+// The wanter and sender lists are compacted in place, keeping their order.
+void Graph::removeOrphans(QList<Edge*> *ptrCulled)
 {
-  // Count the number of nodes with at least one wanter
-  for (int idx=wanters.size()-1; idx>=0  &&  *ptrKeepRunning; idx--)
+  QList<Node*> culledWanters;
+  int kept = 0;
+  for (int idx=0; idx<wanters.size(); idx++)
   {
-    if (wanters.at(idx)->edges.size() < 2)
+    Node *ptrWanter = wanters.at(idx);
+    if (ptrWanter->edges.size() < 2)
     {
       // There should always be at least one edge (between the sender and wanter)
-      Q_ASSERT(wanters.at(idx)->edges.size() == 1);
-      Q_ASSERT(wanters.at(idx)->edges.at(0)->ptrSender == wanters.at(idx)->ptrTwin);
-      edgeDelQueue.append(wanters.at(idx)->edges.at(0));
-      orphans.append(wanters[idx]);
-      wanters.removeAt(idx);
+      Q_ASSERT(ptrWanter->edges.size() == 1);
+      Q_ASSERT(ptrWanter->edges.at(0)->ptrSender == ptrWanter->ptrTwin);
+      ptrCulled->append(ptrWanter->edges.at(0));
+      ptrWanter->edges.clear();
+      ptrWanter->ptrTwin = NULL; // deleted below
+      culledWanters.append(ptrWanter);
     }
     else
-      if (!wanters.at(idx)->isDummy) // count viable, non-dummy items
+    {
+      if (!ptrWanter->isDummy) // count viable, non-dummy items
         viableRealItems++;
+      wanters[kept++] = ptrWanter;
+    }
   }
+  while (wanters.size() > kept)
+    wanters.removeLast();
+  // Orphans are listed from the last wanter to the first
+  for (int idx=culledWanters.size()-1; idx>=0; idx--)
+    orphans.append(culledWanters.at(idx));
 
-  for (int idx=senders.size()-1; idx>=0; idx--)
+  kept = 0;
+  for (int idx=0; idx<senders.size(); idx++)
   {
-    if (senders.at(idx)->edges.size() < 2)
-    {
-      edgeDelQueue.append(senders.at(idx)->edges.at(0));
-      delete senders[idx];
-      senders.removeAt(idx);
-    }
+    Node *ptrSender = senders.at(idx);
+    if (ptrSender->edges.size() < 2)
+      delete ptrSender; // its only edge is already in ptrCulled
+    else
+      senders[kept++] = ptrSender;
   }
+  while (senders.size() > kept)
+    senders.removeLast();
 }
 
 
 //////////////////////////////////////////////////////////////////////////////
 
 
-void Graph::dijkstra(Heap *ptrHeap)
+template <class HeapType>
+void Graph::dijkstra(HeapType *ptrHeap)
 {
-  ptrSinkFrom = NULL;
+  int n = numWanters;
+  const int *start = arcStart.constData();
+  const int *head = arcHead.constData();
+  const quint64 *arcCosts = arcCost.constData();
+  const quint64 *prices = price.constData();
+  const int *matches = match.constData();
+  const quint64 *matchCosts = matchCost.constData();
+  int *froms = from.data();
+
+  sinkFrom = NO_NODE;
   sinkCost = MAX_VALUE;
+  PROFILE_COUNT(counters.rounds, 1);
+  PROFILE_COUNT(counters.inserts, 2*n);
 
   // Insert all nodes, both wanter and sender, into the heap
-  for (int idx=0; idx<senders.size(); idx++)
+  ptrHeap->clear();
+  for (int id=n; id<2*n; id++)
   {
-    senders.at(idx)->ptrFrom = NULL;
+    froms[id] = NO_NODE;
     // Give entry the highest cost
-    senders.at(idx)->ptrHeapEntry = ptrHeap->insert(senders.at(idx), INFINITY);
+    ptrHeap->insert(id, INFINITY);
   }
-  for (int idx=0; idx<wanters.size(); idx++)
+  for (int id=0; id<n; id++)
   {
-    wanters.at(idx)->ptrFrom = NULL;
+    froms[id] = NO_NODE;
     // Give entry highest cost if unmatched, else lowest
-    quint64 cost = (wanters.at(idx)->ptrMatch == NULL) ? 0 : INFINITY;
-    wanters.at(idx)->ptrHeapEntry = ptrHeap->insert(wanters.at(idx), cost);
+    quint64 cost = (matches[id] == NO_NODE) ? 0 : INFINITY;
+    ptrHeap->insert(id, cost);
   }
 
   while (!ptrHeap->isEmpty())
   {
     // Grab the lowest cost entry's node and cost
-    Entry *ptrMinEntry = ptrHeap->extractMin();
-    Node *ptrNode = ptrMinEntry->ptrNode;
-    quint64 cost = ptrMinEntry->cost;
-    int size;
+    int node = ptrHeap->extractMin();
+    quint64 cost = ptrHeap->cost(node);
+    PROFILE_COUNT(counters.extracts, 1);
 
     if (cost == INFINITY)
       break; // everything left is unreachable
+    PROFILE_COUNT(counters.settled, 1);
 
-    if (ptrNode->type == WANTS)
-    {
-      size = ptrNode->edges.size();
-      for(int idx=0; idx<size; idx++)
+    if (node < n)
+    { // WANTS
+      int end = start[node+1];
+      for (int arc=start[node]; arc<end; arc++)
       {
-        Node *ptrOther = ptrNode->edges.at(idx)->ptrSender;
-        if (ptrOther == ptrNode->ptrMatch)
+        int other = head[arc];
+        if (other == matches[node])
           continue; // ignore item's current match
         // Price of wanter->sender is WantPrice + edgeCost - SendPrice
         // Note: The SendPrice is typically the value of the sender's lowest edgeCost
         //       until all edges' nodes have been matched, then it's infinite.
-        quint64 c = ptrNode->price + ptrNode->edges.at(idx)->cost - ptrOther->price;
+        quint64 c = prices[node] + arcCosts[arc] - prices[other];
         Q_ASSERT(c <= MAX_VALUE); // per algorithm, all costs must be non-negative
-        if (cost + c < ptrOther->ptrHeapEntry->cost)
+        PROFILE_COUNT(counters.relaxations, 1);
+        if (cost + c < ptrHeap->cost(other))
         {
           // We found a cheaper path between the node and this sender
-          ptrHeap->decreaseCost(ptrOther->ptrHeapEntry, cost+c);
-          ptrOther->ptrFrom = ptrNode;
+          ptrHeap->decreaseCost(other, cost+c);
+          PROFILE_COUNT(counters.decreaseKeys, 1);
+          froms[other] = node;
         }
       }
     }
-    else if (ptrNode->ptrMatch == NULL)
+    else if (matches[node] == NO_NODE)
     { // unmatched SENDS
       if (cost < sinkCost)
       {
-        ptrSinkFrom = ptrNode;
+        sinkFrom = node;
         sinkCost = cost;
       }
     }
     else
     { // matched SENDER
-      Node *ptrOther = ptrNode->ptrMatch;
+      int other = matches[node];
       // Price of sender->wanter is SendPrice + edgeCost - WantPrice
       // Note: The WantPrice is low until everything wanting the item is matched up
-      quint64 c = ptrNode->price - ptrOther->matchCost - ptrOther->price;
+      quint64 c = prices[node] - matchCosts[other] - prices[other];
       Q_ASSERT(c <= MAX_VALUE); // per algorithm, all costs must be non-negative
-      if (cost + c < ptrOther->ptrHeapEntry->cost)
+      PROFILE_COUNT(counters.relaxations, 1);
+      if (cost + c < ptrHeap->cost(other))
       {
-        ptrHeap->decreaseCost(ptrOther->ptrHeapEntry, cost+c);
-        ptrOther->ptrFrom = ptrNode;
+        ptrHeap->decreaseCost(other, cost+c);
+        PROFILE_COUNT(counters.decreaseKeys, 1);
+        froms[other] = node;
       }
     }
   } // end while(!heap.isEmpty)
 } // end dijkstra()
 
 
+// Lazy variant of dijkstra(). Only the unmatched wanters start out in the
+// heap, other nodes are inserted when they are first reached, and the search
+// stops as soon as the cheapest unmatched sender is extracted. The nodes
+// extracted before it are listed in settled[].
+template <class HeapType>
+void Graph::dijkstraLazy(HeapType *ptrHeap, unsigned int stamp)
+{
+  int n = numWanters;
+  const int *start = arcStart.constData();
+  const int *head = arcHead.constData();
+  const quint64 *arcCosts = arcCost.constData();
+  const quint64 *prices = price.constData();
+  const int *matches = match.constData();
+  const quint64 *matchCosts = matchCost.constData();
+  int *froms = from.data();
+  unsigned int *reach = reached.data();
+
+  sinkFrom = NO_NODE;
+  sinkCost = MAX_VALUE;
+  numSettled = 0;
+  PROFILE_COUNT(counters.rounds, 1);
+  PROFILE_COUNT(counters.inserts, numSources);
+
+  ptrHeap->clear();
+  for (int idx=0; idx<numSources; idx++)
+  {
+    int id = sources.at(idx);
+    reach[id] = stamp;
+    froms[id] = NO_NODE;
+    ptrHeap->insert(id, 0);
+  }
+
+  while (!ptrHeap->isEmpty())
+  {
+    int node = ptrHeap->extractMin();
+    quint64 cost = ptrHeap->cost(node);
+    PROFILE_COUNT(counters.extracts, 1);
+
+    if (node >= n  &&  matches[node] == NO_NODE)
+    { // the cheapest unmatched SENDS node ends the search
+      sinkFrom = node;
+      sinkCost = cost;
+      break;
+    }
+    settled[numSettled++] = node;
+    PROFILE_COUNT(counters.settled, 1);
+
+    if (node < n)
+    { // WANTS
+      int end = start[node+1];
+      for (int arc=start[node]; arc<end; arc++)
+      {
+        int other = head[arc];
+        if (other == matches[node])
+          continue; // ignore item's current match
+        quint64 c = prices[node] + arcCosts[arc] - prices[other];
+        Q_ASSERT(c <= MAX_VALUE); // per algorithm, all costs must be non-negative
+        PROFILE_COUNT(counters.relaxations, 1);
+        if (reach[other] != stamp)
+        { // first time this round that the sender is reached
+          reach[other] = stamp;
+          froms[other] = node;
+          ptrHeap->insert(other, cost+c);
+          PROFILE_COUNT(counters.inserts, 1);
+        }
+        else if (cost + c < ptrHeap->cost(other))
+        {
+          ptrHeap->decreaseCost(other, cost+c);
+          PROFILE_COUNT(counters.decreaseKeys, 1);
+          froms[other] = node;
+        }
+      }
+    }
+    else
+    { // matched SENDER
+      int other = matches[node];
+      quint64 c = prices[node] - matchCosts[other] - prices[other];
+      Q_ASSERT(c <= MAX_VALUE); // per algorithm, all costs must be non-negative
+      PROFILE_COUNT(counters.relaxations, 1);
+      if (reach[other] != stamp)
+      {
+        reach[other] = stamp;
+        froms[other] = node;
+        ptrHeap->insert(other, cost+c);
+        PROFILE_COUNT(counters.inserts, 1);
+      }
+      else if (cost + c < ptrHeap->cost(other))
+      {
+        ptrHeap->decreaseCost(other, cost+c);
+        PROFILE_COUNT(counters.decreaseKeys, 1);
+        froms[other] = node;
+      }
+    }
+  } // end while(!heap.isEmpty)
+} // end dijkstraLazy()
+
+
+// Flip the matching along the path to the sink found by the last search,
+// which runs back through from[] to the unmatched wanter that heads it.
+void Graph::augment()
+{
+  int sender = sinkFrom;
+  int wanter = NO_NODE;
+  Q_ASSERT(sender != NO_NODE);
+  while (sender != NO_NODE)
+  {
+    wanter = from.at(sender);
+
+    // Unlink sender and wanter from current matches
+    if (match.at(sender) != NO_NODE)
+      match[match.at(sender)] = NO_NODE;
+    if (match.at(wanter) != NO_NODE)
+      match[match.at(wanter)] = NO_NODE;
+
+    // Set the sender/receiver match to each other
+    match[sender] = wanter;
+    match[wanter] = sender;
+
+    // Update matchCost
+    for (int arc=arcStart.at(wanter); arc<arcStart.at(wanter+1); arc++)
+    { // iterate until we find the corresponding edge
+      if (arcHead.at(arc) == sender)
+      {
+        matchCost[wanter] = arcCost.at(arc);
+        break;
+      }
+    }
+
+    sender = from.at(wanter); // evaluate the sender node this was connected to previously
+  }
+
+  // The wanter heading the path is no longer unmatched
+  int last = sources.at(--numSources);
+  sources[sourceSlot.at(wanter)] = last;
+  sourceSlot[last] = sourceSlot.at(wanter);
+}
+
+
+// After the prices have been updated, every arc on a cheapest path has a
+// reduced cost of zero. This looks for more augmenting paths made up only
+// of such arcs, using one depth-first search per unmatched wanter (as in the
+// phases of Hopcroft-Karp). Nodes are not revisited within a call, so the
+// paths found are vertex-disjoint. Flipping a zero-cost path leaves all
+// reduced costs non-negative and those on the matching at zero, so the
+// final matching is still of minimum cost. Returns the number of paths.
+int Graph::augmentEqualityPaths()
+{
+  const int *start = arcStart.constData();
+  const int *head = arcHead.constData();
+  const quint64 *arcCosts = arcCost.constData();
+  const quint64 *prices = price.constData();
+  const int *matches = match.constData();
+  int *froms = from.data();
+  unsigned int *visit = reached.data();
+  unsigned int stamp = ++searchStamp;
+  int found = 0;
+
+  // Go through the unmatched wanters backwards, since augment() replaces
+  // each one it matches with the last one in the list
+  for (int idx=numSources-1; idx>=0; idx--)
+  {
+    int source = sources.at(idx);
+    if (visit[source] == stamp)
+      continue;
+    visit[source] = stamp;
+    froms[source] = NO_NODE;
+    int depth = 0;
+    stack[depth] = source;
+    cursor[source] = start[source];
+
+    while (depth >= 0)
+    {
+      int wanter = stack.at(depth);
+      if (cursor.at(wanter) == start[wanter+1])
+      {
+        depth--; // dead end; back up
+        continue;
+      }
+      int arc = cursor[wanter]++;
+      int sender = head[arc];
+      if (sender == matches[wanter]  ||  visit[sender] == stamp  ||
+          prices[wanter] + arcCosts[arc] - prices[sender] != 0)
+        continue;
+      visit[sender] = stamp;
+      froms[sender] = wanter;
+
+      if (matches[sender] == NO_NODE)
+      { // found an unmatched sender
+        sinkFrom = sender;
+        augment();
+        found++;
+        break;
+      }
+
+      // Carry on through the wanter currently matched to this sender
+      int next = matches[sender];
+      if (visit[next] == stamp  ||
+          prices[sender] - matchCost.at(next) - prices[next] != 0)
+        continue;
+      visit[next] = stamp;
+      froms[next] = sender;
+      stack[++depth] = next;
+      cursor[next] = start[next];
+    }
+  }
+  return found;
+}
+
+
+// Returns the findCycles() progress from 1..256, for other threads to show.
+// The components solved by matchComponents() only count their matches, so
+// the whole graph's progress is worked out from those here.
+int Graph::getProgress()
+{
+  int current = progress.loadAcquire();
+  if (!splitComponents  ||  numWanters == 0)
+    return current;
+  return qMax(current, (numMatched.loadAcquire()<<8)/numWanters+1);
+}
+
+
+// Updates the progress and waits out pauses. Returns false if the operation
+// has been canceled.
+bool Graph::checkIn(int matched)
+{
+  if (ptrWhole != NULL)
+  {
+    // We are one component of a larger graph, so only add our matches to
+    // its count, from which its progress is worked out (see getProgress())
+    ptrWhole->numMatched.fetchAndAddRelaxed(matched - reportedMatched);
+    reportedMatched = matched;
+  }
+  else
+    progress.storeRelease((matched<<8)/numWanters+1);
+  if (!ptrKeepRunning->loadAcquire())
+    return false;
+  while (ptrPaused->loadAcquire())
+    QThread::sleep(1); // delay for a second
+  return true;
+}
+
+
+// Performs one dijkstra() round and augmentation per wanter. The heap is
+// allocated once for the whole solve, outside of dijkstra(), because we want
+// to keep using its costs after each round. Returns false if canceled.
+template <class HeapType>
+bool Graph::matchAll()
+{
+  int n = numWanters;
+  HeapType heap(2*n);
+
+  for (int round=0; numSources > 0; round++)
+  {
+    if ((round & 0x3F) == 0  &&  !checkIn(n-numSources))
+      return false; // only check in every so often, to keep the rounds cheap
+
+    dijkstra(&heap);
+    augment();
+
+    // Update the prices
+    for (int id=0; id<2*n; id++)
+    {
+      price[id] += heap.cost(id);
+      if (price.at(id) > MAX_VALUE)
+        price[id] = MAX_VALUE; // prevent unsigned from wrapping
+    }
+
+    if (multiAugment)
+      augmentEqualityPaths();
+  }
+  return true;
+}
+
+
+// Same rounds as matchAll(), but built on dijkstraLazy() so that a round
+// costs about as much as the part of the graph cheaper than its sink.
+// Adding min(cost, sinkCost) to every price keeps all reduced costs
+// non-negative and those along the new matching at zero. Since adding the
+// same amount to every price changes no reduced cost, we instead lower just
+// the settled nodes by (sinkCost - cost) and leave everything else alone.
+// Prices may then wrap below zero, but only their differences are ever used,
+// and those come out right in unsigned arithmetic.
+template <class HeapType>
+bool Graph::matchAllLazy()
+{
+  int n = numWanters;
+  HeapType heap(2*n);
+  settled.resize(2*n);
+
+  for (int round=0; numSources > 0; round++)
+  {
+    if ((round & 0x3F) == 0  &&  !checkIn(n-numSources))
+      return false; // only check in every so often, to keep the rounds cheap
+
+    dijkstraLazy(&heap, ++searchStamp);
+    augment();
+
+    // Update the prices of the settled nodes
+    for (int idx=0; idx<numSettled; idx++)
+    {
+      int id = settled.at(idx);
+      price[id] += heap.cost(id) - sinkCost;
+    }
+
+    if (multiAugment)
+      augmentEqualityPaths();
+  }
+  return true;
+}
+
+
+// Resolves AUTO_HEAP: Dial's buckets when the rounds are lazy and the costs
+// of the wants fit in the bucket window, and the radix heap otherwise.
+// dijkstra() starts every node out at INFINITY, so without the lazy rounds
+// nearly all of them would sit in the bucket heap's overflow list. The
+// self-edges and the edges out of dummies all cost NONTRADE-COST (a billion
+// by default), so they are left out of the range, or it would never fit.
+HEAP_TYPE Graph::solverHeapType()
+{
+  if (heapType != AUTO_HEAP)
+    return heapType;
+  if (!lazyDijkstra)
+    return RADIX_HEAP;
+
+  quint64 maxCost = 0;
+  for (int id=0; id<numWanters; id++)
+  {
+    if (nodeAt.at(id)->isDummy)
+      continue;
+    for (int arc=arcStart.at(id); arc<arcStart.at(id+1); arc++)
+      if (arcHead.at(arc) != twinOf.at(id)  &&  arcCost.at(arc) > maxCost)
+        maxCost = arcCost.at(arc);
+  }
+  return (maxCost < BUCKET_WINDOW) ? BUCKET_HEAP : RADIX_HEAP;
+}
+
+
+// Finds a minimum cost perfect matching over the flat solver layout, leaving
+// it in match and matchCost. Returns false if canceled.
+bool Graph::solveMatching()
+{
+  int n = numWanters;
+
+  // Initialize all nodes. Every wanter starts out unmatched.
+  price.resize(2*n);
+  match.resize(2*n);
+  matchCost.fill(0, n);
+  from.fill(NO_NODE, 2*n);
+  sources.resize(n);
+  sourceSlot.resize(n);
+  numSources = n;
+  for (int id=0; id<n; id++)
+  {
+    match[id] = NO_NODE;
+    price[id] = 0;
+    sources[id] = id;
+    sourceSlot[id] = id;
+  }
+  for (int id=n; id<2*n; id++)
+  {
+    // A sender starts out priced at its cheapest incoming edge
+    match[id] = NO_NODE;
+    price[id] = MAX_VALUE;
+    for (int arc=arcStart.at(id); arc<arcStart.at(id+1); arc++)
+      if (arcCost.at(arc) < price.at(id))
+        price[id] = arcCost.at(arc);
+  }
+  reached.fill(0, 2*n);
+  searchStamp = 0;
+  if (multiAugment)
+  {
+    stack.resize(n);
+    cursor.resize(n);
+  }
+
+  // Run the matching rounds on the requested priority queue
+  bool completed;
+  if (lazyDijkstra)
+  {
+    switch (solverHeapType())
+    {
+      case QUAD_HEAP:   completed = matchAllLazy<QuadHeap>();    break;
+      case RADIX_HEAP:  completed = matchAllLazy<RadixHeap>();   break;
+      case BUCKET_HEAP: completed = matchAllLazy<BucketHeap>();  break;
+      default:          completed = matchAllLazy<PairingHeap>(); break;
+    }
+  }
+  else
+  {
+    switch (solverHeapType())
+    {
+      case QUAD_HEAP:   completed = matchAll<QuadHeap>();    break;
+      case RADIX_HEAP:  completed = matchAll<RadixHeap>();   break;
+      case BUCKET_HEAP: completed = matchAll<BucketHeap>();  break;
+      default:          completed = matchAll<PairingHeap>(); break;
+    }
+  }
+  return completed;
+}
+
+
+// Orders components from largest to smallest for matchComponents()
+static bool hasMoreNodes(const QVector<int> &a, const QVector<int> &b)
+{
+  return a.size() > b.size();
+}
+
+// Solves each strongly connected component as a matching problem of its own.
+// removeImpossibleEdges() leaves no edges between components, so putting the
+// optimal matchings of the components together gives an optimal matching of
+// the whole graph. The components are solved concurrently on the global thread
+// pool, largest first, so the small ones get finished while the big one runs.
+// The total cost and number of trades are the same as when solving the whole
+// graph at once, but where a round has several equally cheap choices, the
+// component may settle on a different one. Returns false if canceled.
+bool Graph::matchComponents()
+{
+  int n = numWanters;
+
+  // Gather the node ids of each component: its wanters in wanter order
+  // followed by its senders in sender order
+  QHash<int,int> partIndex; // component number -> index into members
+  QVector< QVector<int> > members;
+  for (int id=0; id<2*n; id++)
+  {
+    int label = nodeAt.at(id)->component;
+    if (!partIndex.contains(label))
+    {
+      partIndex.insert(label, members.size());
+      members.append(QVector<int>());
+    }
+    members[partIndex.value(label)].append(id);
+  }
+  if (members.size() < 2)
+    return solveMatching(); // nothing to split
+  std::stable_sort(members.begin(), members.end(), hasMoreNodes);
+
+  // Renumber every node within its component and build the components.
+  // They only get the arcs, so AUTO_HEAP is resolved for them here.
+  heapType = solverHeapType();
+  QVector<int> localId(2*n);
+  QVector<Graph*> parts;
+  for (int idx=0; idx<members.size(); idx++)
+  {
+    const QVector<int> &ids = members.at(idx);
+    for (int local=0; local<ids.size(); local++)
+      localId[ids.at(local)] = local;
+    Graph *ptrPart = new Graph();
+    extractComponent(ids, localId, ptrPart);
+    parts.append(ptrPart);
+  }
+
+  // The copies come without their own solver state (see copy()), and the
+  // components only fill in theirs, so size the arrays they are stitched into
+  match.fill(NO_NODE, 2*n);
+  matchCost.fill(0, n);
+  numMatched = 0;
+  QtConcurrent::blockingMap(parts, &Graph::solveComponent);
+
+  // Stitch the components' matchings back together
+  bool completed = true;
+  for (int idx=0; idx<parts.size(); idx++)
+  {
+    Graph *ptrPart = parts.at(idx);
+    const QVector<int> &ids = members.at(idx);
+    completed = completed && ptrPart->solved;
+    PROFILE_ADD(counters, ptrPart->counters);
+    if (ptrPart->solved)
+    {
+      int m = ptrPart->numWanters;
+      for (int local=0; local<2*m; local++)
+      {
+        int id = ids.at(local);
+        match[id] = ids.at(ptrPart->match.at(local));
+        if (local < m)
+          matchCost[id] = ptrPart->matchCost.at(local);
+      }
+    }
+    delete ptrPart;
+  }
+  return completed;
+}
+
+// Copies the flat solver layout of one component (ids, numbered within the
+// component by localId) into an empty graph
+void Graph::extractComponent(const QVector<int> &ids, const QVector<int> &localId, Graph *ptrPart)
+{
+  int m = ids.size()/2; // nodes always come in wanter-sender pairs
+
+  ptrPart->numWanters = m;
+  ptrPart->arcStart.resize(2*m+1);
+  for (int local=0; local<2*m; local++)
+  {
+    int id = ids.at(local);
+    ptrPart->arcStart[local] = ptrPart->arcHead.size();
+    for (int arc=arcStart.at(id); arc<arcStart.at(id+1); arc++)
+    {
+      ptrPart->arcHead.append(localId.at(arcHead.at(arc)));
+      ptrPart->arcCost.append(arcCost.at(arc));
+    }
+  }
+  ptrPart->arcStart[2*m] = ptrPart->arcHead.size();
+
+  ptrPart->heapType = heapType;
+  ptrPart->lazyDijkstra = lazyDijkstra;
+  ptrPart->multiAugment = multiAugment;
+  ptrPart->ptrKeepRunning = ptrKeepRunning;
+  ptrPart->ptrPaused = ptrPaused;
+  ptrPart->ptrWhole = this;
+  ptrPart->frozen = true;
+}
+
+// Used with QtConcurrent to solve one component made by matchComponents()
+void Graph::solveComponent(Graph *&ptrPart)
+{
+  ptrPart->solved = ptrPart->solveMatching();
+}
+
+
 // The findcycles() function uses dijkstra's algorithm to find perfect matching.
 // It iterates once for each WANTER/SENDER pair, doing the following:
 //   1) Look at unmatched WANTER
@@ -382,100 +1175,42 @@ CyclesType* Graph::findCycles()
 {
   Q_ASSERT(frozen); // graph analysis should only be performed when we are done adding things
 
-  // Initialize all nodes
-  for (int idx=0; idx<wanters.size(); idx++)
-  {
-    wanters.at(idx)->ptrMatch = NULL;
-    wanters.at(idx)->price = 0;
-  }
-  for (int idx=0; idx<senders.size(); idx++)
-  {
-    senders.at(idx)->ptrMatch = NULL;
-    senders.at(idx)->price = senders.at(idx)->minimumInCost;
-  }
+  layOut();
 
-  for (int round = 0; round < wanters.size(); round++)
-  {
-    if ((round & 0x3F) == 0)
-    {
-      progress = (round<<8)/wanters.size()+1;
-      if (*ptrKeepRunning == false)
-        return NULL;
-      while (*ptrPaused)
-        QThread::sleep(1); // delay for a second
-    }
+  bool completed;
+  if (splitComponents)
+    completed = matchComponents();
+  else
+    completed = solveMatching();
+  if (!completed)
+    return NULL;
 
-    // Allocate the heap here instead of inside dijkstra() because
-    // we want to keep using the heapEntries afterwards.
-    Heap heap(senders.size()*2);
-    dijkstra(&heap);
-
-    // Update the matching
-    Node *ptrSender = ptrSinkFrom;
-    Q_ASSERT(ptrSender != NULL);
-    while (ptrSender != NULL)
-    {
-      Node *ptrWanter = ptrSender->ptrFrom;
-
-      // Unlink sender and wanter from current matches
-      if (ptrSender->ptrMatch != NULL)
-        ptrSender->ptrMatch->ptrMatch = NULL;
-      if (ptrWanter->ptrMatch != NULL)
-        ptrWanter->ptrMatch->ptrMatch = NULL;
-
-      // Set the sender/receiver match to each other
-      ptrSender->ptrMatch = ptrWanter;
-      ptrWanter->ptrMatch = ptrSender;
-
-      // Update matchCost
-      int size = ptrWanter->edges.size();
-      for (int idx=0; idx<size; idx++)
-      { // iterate until we find the corresponding edge
-        if (ptrWanter->edges.at(idx)->ptrSender == ptrSender)
-        {
-          ptrWanter->matchCost = ptrWanter->edges.at(idx)->cost;
-          break;
-        }
-      }
-
-      ptrSender = ptrWanter->ptrFrom; // evaluate the sender node this was connected to previously
-    }
-
-    // Update the prices
-    for (int idx=0; idx<wanters.size(); idx++)
-    {
-      wanters.at(idx)->price += wanters.at(idx)->ptrHeapEntry->cost;
-      if (wanters.at(idx)->price > MAX_VALUE)
-        wanters.at(idx)->price = MAX_VALUE; // prevent unsigned from wrapping
-    }
-    for (int idx=0; idx<senders.size(); idx++)
-    {
-      senders.at(idx)->price += senders.at(idx)->ptrHeapEntry->cost;
-      if (senders.at(idx)->price > MAX_VALUE)
-        senders.at(idx)->price = MAX_VALUE; // prevent unsigned from wrapping
-    }
-  }
-  progress = 256;
+  progress.storeRelease(256);
 
   // Bypass dummy entries that are matched and match the dummies to themselves
   elideDummies();
 
-  timestamp++;
+  int n = numWanters;
+  QVector<char> visited(n, 0);
   CyclesType *ptrCycles = new CyclesType();
 
-  // Assemble the results
-  for (int idx=0; idx<wanters.size(); idx++)
+  // Assemble the results. The nodes may be shared with other copies of the
+  // graph, so the matches are only filled in on the copies in the cycles.
+  for (int idx=0; idx<n; idx++)
   {
-    Node *ptrNode = wanters.at(idx);
-    if (ptrNode->mark == timestamp || ptrNode->ptrMatch == ptrNode->ptrTwin)
+    int id = idx;
+    if (visited.at(id) || match.at(id) == twinOf.at(id))
       continue; // don't add unmatched entries
 
     QList<Node> *ptrCyc = new QList<Node>();
-    while (ptrNode->mark != timestamp)
+    while (!visited.at(id))
     {
-      ptrNode->mark = timestamp;
-      ptrCyc->append(*ptrNode);
-      ptrNode = ptrNode->ptrMatch->ptrTwin;
+      visited[id] = true;
+      Node node = *nodeAt.at(id);
+      node.ptrMatch = nodeAt.at(match.at(id));
+      node.matchCost = matchCost.at(id);
+      ptrCyc->append(node);
+      id = twinOf.at(match.at(id));
     }
     ptrCycles->append(ptrCyc);
   }
@@ -493,102 +1228,91 @@ void Graph::shuffle(JavaRand &random)
   // match.
 
   // Shuffle the order of WANTER nodes
-  for (int i = wanters.size(); i > 1; i--)
+  for (int i = numWanters; i > 1; i--)
   {
     int j = random.nextInt(i);
-    Node *tmp = wanters.at(j);
-    wanters[j] = wanters.at(i-1);
-    wanters[i-1] = tmp;
+    int tmp = wanterOrder.at(j);
+    wanterOrder[j] = wanterOrder.at(i-1);
+    wanterOrder[i-1] = tmp;
   }
 
   // Shuffle the order of edges on WANTER nodes
-  for (int a = 0; a < wanters.size(); a++)
+  for (int a = 0; a < numWanters; a++)
   {
-    Node *n = wanters.at(a);
-    for (int i = n->edges.size(); i > 1; i--)
+    int first = arcStart.at(wanterOrder.at(a));
+    for (int i = arcStart.at(wanterOrder.at(a)+1) - first; i > 1; i--)
     {
       int j = random.nextInt(i);
-      Edge *tmp = n->edges.at(j);
-      n->edges[j] = n->edges.at(i-1);
-      n->edges[i-1] = tmp;
+      int tmp = arcOrder.at(first+j);
+      arcOrder[first+j] = arcOrder.at(first+i-1);
+      arcOrder[first+i-1] = tmp;
     }
   }
+  reordered = true;
 }
 
 
 // Bypass dummy entries that are matched and match the dummies to themselves
 void Graph::elideDummies()
 {
-  for (int idx=0; idx<wanters.size(); idx++)
+  for (int id=0; id<numWanters; id++)
   {
-    if (wanters.at(idx)->isDummy)
+    if (nodeAt.at(id)->isDummy)
       continue;
 
-    while (wanters.at(idx)->ptrMatch->isDummy)
+    while (nodeAt.at(match.at(id))->isDummy)
     {
-      Node *ptrDummySender = wanters.at(idx)->ptrMatch;
-      Node *ptrNextSender = ptrDummySender->ptrTwin->ptrMatch;
-      wanters.at(idx)->ptrMatch = ptrNextSender;
-      ptrNextSender->ptrMatch = wanters.at(idx);
-      ptrDummySender->ptrMatch = ptrDummySender->ptrTwin;
-      ptrDummySender->ptrTwin->ptrMatch = ptrDummySender;
+      int dummySender = match.at(id);
+      int nextSender = match.at(twinOf.at(dummySender));
+      match[id] = nextSender;
+      match[nextSender] = id;
+      match[dummySender] = twinOf.at(dummySender);
+      match[twinOf.at(dummySender)] = dummySender;
     }
   }
 }
 
 
-// Some of the stuff in this function is a little wonky because we want to
-// maintain the same node and edge ordering so that the program remains
-// compatible with TradeMaximizer's results.
+// Returns the wanters that findCycles() left matched to their own senders
+QList<Node*> Graph::untraded()
+{
+  QList<Node*> result;
+  for (int id=0; id<numWanters; id++)
+    if (match.at(id) == twinOf.at(id))
+      result.append(nodeAt.at(id));
+  return result;
+}
+
+
+// Makes a copy for one iteration. Nothing about the nodes and edges changes
+// once they are culled, so the copy shares them and the compiled layout with
+// this graph. QVector shares the data until one side writes to it. The copy
+// only gets its own shuffled orders, and findCycles() lays out its own arrays
+// from them in its thread. The copy owns no nodes; it must not outlive this
+// graph.
 void Graph::copy(Graph *ptrEmptyGraph)
 {
   Q_ASSERT(frozen); // graph shouldn't be duplicated until it is complete
   Q_ASSERT(ptrEmptyGraph != NULL);
 
-  // Create copies of nodes in the new graph. We can't use addNode() becuase
-  // we need to maintain the node ordering.
-  // First, we copy the receivers in their (shuffled) order
-  for (int idx=0; idx<wanters.size(); idx++)
-  {
-    Node *n = wanters.at(idx);
-    Node *ptrWanter = new Node(n->name, n->owner, n->isDummy, WANTS);
-    ptrEmptyGraph->wanters.append(ptrWanter);
-    ptrEmptyGraph->nameMap.insert(n->name, ptrWanter);
-  }
-  // Then we copy the senders in their (original) order
-  for (int idx=0; idx<senders.size(); idx++)
-  {
-    Node *n = senders.at(idx);
-    Node *ptrSender = new Node(n->name, n->owner, n->isDummy, SENDS);
-    ptrEmptyGraph->senders.append(ptrSender);
-    // Link twin nodes together
-    QString wantName = n->name.left(n->name.length()-7); // take off " sender"
-    Node *ptrWanter = ptrEmptyGraph->getNode(wantName);
-    ptrWanter->ptrTwin = ptrSender;
-    ptrSender->ptrTwin = ptrWanter;
-  }
-
-  // Edges go between senders and wanters, so we need only look at one side
-  // to copy all the edges over. However, we need to add them in the same order
-  // they were originally added, so we traverse the senders, which were never
-  // shuffled, then look at their matching wanters, to keep the edge order the
-  // same.
-  for (int i=0; i<senders.size(); i++)    // in sender order
-  {
-    Node *n = senders.at(i)->ptrTwin;     // evaluate wanters'
-    for (int j=0; j<n->edges.size(); j++) // edges
-    {
-      Edge *e = n->edges.at(j);
-      Node *ptrWanter = ptrEmptyGraph->getNode(e->ptrWanter->name);
-      Node *ptrSender = ptrEmptyGraph->getNode(e->ptrSender->ptrTwin->name)->ptrTwin;
-      ptrEmptyGraph->addEdge(ptrWanter, ptrSender, e->cost);
-    }
-  }
+  ptrEmptyGraph->numWanters = numWanters;
+  ptrEmptyGraph->nodeAt = nodeAt;
+  ptrEmptyGraph->twinOf = twinOf;
+  ptrEmptyGraph->arcStart = arcStart;
+  ptrEmptyGraph->arcHead = arcHead;
+  ptrEmptyGraph->arcCost = arcCost;
+  ptrEmptyGraph->wanterOrder = wanterOrder;
+  ptrEmptyGraph->arcOrder = arcOrder;
+  ptrEmptyGraph->reordered = reordered;
+  ptrEmptyGraph->frozen = true;
 
   ptrEmptyGraph->numCopies = ++numCopies;
+  ptrEmptyGraph->heapType = heapType;
+  ptrEmptyGraph->lazyDijkstra = lazyDijkstra;
+  ptrEmptyGraph->multiAugment = multiAugment;
+  ptrEmptyGraph->splitComponents = splitComponents;
   ptrEmptyGraph->ptrKeepRunning = ptrKeepRunning;
   ptrEmptyGraph->ptrPaused = ptrPaused;
   ptrEmptyGraph->viableRealItems = viableRealItems; // not used in copies, but copy it anyway
-  ptrEmptyGraph->freeze(); // lock down the populated graph
 }
 
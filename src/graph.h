@@ -1,18 +1,22 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
-#include <QHash> // for storing the nameMap
+#include <QVector> // for the flat solver layout and the nameMap
+#include <QAtomicInt> // for flags and progress shared between threads
 #include "heap.h"
 #include "javarand.h"
+#include "symbols.h"
+#include "profile.h"
 
 #define MAX_VALUE  9223372036854775807ULL   // (2^63 - 1)
+#define NO_NODE    (-1)                     // empty slot in the flat solver arrays
+#define NO_PART    (-1)                     // wanter already in the pivot's component
+#define SCC_PARALLEL_ITEMS 20000            // items needed to find components in parallel
 
 // Forward class declarations
 class Graph; // Contains nodes; handles graph algorithms
 class Node;  // Contains edges and name data
 class Edge;  // Connects two nodes together
-class Entry; // (heap.h)
-class Heap;  // (heap.h)
 
 typedef QList< QList<Node>* > CyclesType;
 
@@ -29,14 +33,13 @@ typedef enum _DirectionEnum
 class Node
 {
   public:
-    Node(QString name, QString owner, bool isDummy, DirectionEnum type);
-    bool containsEdge(Node *ptrToNode);
-    void removeBadEdges(QList<Edge*> edgeDelQueue); // used as part of culling impossible edges
+    Node(int nameId, int ownerId, bool isDummy, DirectionEnum type);
+    void removeBadEdges(QList<Edge*> *ptrCulled); // used as part of culling impossible edges
     QString show(bool sortByItem);
 
-    // Very basic node information
-    QString name;  // The name of this item
-    QString owner; // The owner (username) of this item
+    // Very basic node information, as ids into gSymbols
+    int nameId;  // The name of this item
+    int ownerId; // The owner (username) of this item, or EMPTY_SYMBOL
     bool isDummy;
     DirectionEnum type; // The type of node this is
 
@@ -50,11 +53,8 @@ class Node
 
     // Internal data for graph algorithms
     quint64 minimumInCost; // only tracked in the SEND nodes
-    unsigned int mark; // flag used for marking as visited in dfs and dijkstra
-    Node *ptrFrom; // the node associated with the cheapest path in dijkstra
-    quint64 price;
-    Entry* ptrHeapEntry; // contains the current cost (see "from" node); only valid in Heap scope
     int component; // used for removing impossible edges
+    int id; // index into the graph's flat solver layout (see Graph::compile())
 };
 
 
@@ -74,12 +74,13 @@ class Graph
   public:
     Graph();
     ~Graph();
-    Node* getNode(QString name);
-    Node* addNode(QString name, QString owner, bool isDummy);
+    Node* getNode(int nameId);
+    Node* addNode(int nameId, int ownerId, bool isDummy);
     void  addEdge(Node *ptrWanter, Node *ptrSender, quint64 cost);
     void  freeze();
     void  removeImpossibleEdges();
     CyclesType* findCycles(); // the return must be deallocated by caller
+    QList<Node*> untraded();  // wanters left out of the cycles by findCycles()
     void  shuffle(JavaRand &random);
     void  copy(Graph *ptrEmptyGraph);
 
@@ -89,35 +90,104 @@ class Graph
     // culling unusable edges
     QList<Node*> orphans;
     // The nameMap helps make sure we don't duplicate node names
-    // and lets us find WANTER nodes by their names
-    QHash<QString,Node*> nameMap;
-    bool *ptrKeepRunning; // indicates whether operation has been canceled
-    bool *ptrPaused;      // indicates whether operation is temporarily paused
+    // and lets us find WANTER nodes by their names' symbol ids
+    QVector<Node*> nameMap;
+    QAtomicInt *ptrKeepRunning; // cleared when the operation is canceled
+    QAtomicInt *ptrPaused;      // set while the operation is temporarily paused
 
     int numCopies; // Keeps track of which graph copy this is (or how many were made)
-    int progress; // Tracks findCycles() progress from 1..256
+    int getProgress(); // findCycles() progress from 1..256, from any thread
     int viableRealItems; // number of non-dummy items after culling
+    HEAP_TYPE heapType; // priority queue used by findCycles()
+    bool lazyDijkstra;  // use the early-terminating rounds in findCycles()
+    bool multiAugment;  // augment along all zero-cost paths after each round
+    bool splitComponents; // solve each strongly connected component on its own
+#ifdef TRADE_PROFILE
+    SolverCounters counters; // what findCycles() did
+#endif
 
   private:
     void elideDummies();
 
     bool frozen; // the graph is unfrozen and ready for additions by default
     unsigned int timestamp; // used for determining which loop iteration we're running
+    QAtomicInt progress; // Tracks findCycles() progress from 1..256
 
     // These are used for determinng impossible edges (see removeImpossibleEdges())
-    // using Kosaraju's algorithm.
-    void visitWanters(Node *ptrWanter);
-    void visitSenders(Node *ptrSender);
-    void removeOrphans(QList<Edge*> edgeDelQueue);
+    // by finding the strongly connected components over the flat solver layout
+    void findComponents();
+    void markReachable(int pivot, bool forward, QVector<char> *ptrSeen);
+    void labelComponents(int part, int *ptrCount);
+    void removeOrphans(QList<Edge*> *ptrCulled);
     unsigned int component; // used in determining impossible edges
-    // Keep track of which sender nodes have had their wanter twin visited
-    QList<Node*> finished;
-
-
-    // These are used in performing the actual search using Dijkstra's algorithm
-    void dijkstra(Heap *ptrHeap);
-    Node *ptrSinkFrom; // designates the sending node with the lowest cost
+    QVector<int> partOf;    // which search part each wanter is in, or NO_PART
+    QVector<int> compOf;    // wanter id -> its component number within its part
+    QVector<int> dfsIndex;  // the order in which labelComponents() visited each wanter
+    QVector<int> dfsLow;    // lowest dfsIndex reachable from each wanter
+
+
+    // Flat solver layout, built by compile() when the graph is frozen.
+    // Wanters get ids 0..N-1 in their list order and senders get ids N..2N-1
+    // in theirs. The arcs of node id i are arcStart[i] up to arcStart[i+1]-1:
+    // a wanter's arcs lead to the senders it wants (in its edge order) and a
+    // sender's arcs lead back to the wanters wanting it. The Node objects are
+    // only consulted again when reporting results. shuffle() only permutes
+    // wanterOrder and arcOrder, and layOut() applies them to the layout.
+    void compile();
+    void layOut();
+    int numWanters;
+    QVector<Node*> nodeAt;     // id -> node, for reporting results
+    QVector<int> twinOf;       // id -> id of the other half of its wanter-sender pair
+    QVector<int> arcStart;     // 2N+1 offsets into arcHead/arcCost
+    QVector<int> arcHead;      // node id at the far end of each arc
+    QVector<quint64> arcCost;  // edge cost of each arc
+    QVector<int> wanterOrder;  // shuffled position -> wanter id
+    QVector<int> arcOrder;     // shuffled position -> arc, within each wanter's arcs
+    bool reordered;            // whether the orders differ from the layout
+    // Hot per-node solver state, kept apart from the Node objects so that
+    // Dijkstra streams through a few dense arrays instead of chasing pointers
+    QVector<quint64> price;
+    QVector<int> match;        // id of the matched node, or NO_NODE
+    QVector<quint64> matchCost; // cost of each wanter's matched edge
+    QVector<int> from;         // id of the node on the cheapest path in dijkstra
+
+    // These are used in performing the actual search using Dijkstra's algorithm.
+    // They are templates over the priority queue classes in heap.h.
+    HEAP_TYPE solverHeapType();
+    bool checkIn(int matched);
+    void augment();
+    int  augmentEqualityPaths();
+    bool solveMatching();
+    template <class HeapType> bool matchAll();
+    template <class HeapType> void dijkstra(HeapType *ptrHeap);
+    int sinkFrom;      // designates the sending node with the lowest cost
     quint64 sinkCost;  // designates the cost of the cheapest sending node
+
+    QVector<int> sources;    // the unmatched wanters
+    QVector<int> sourceSlot; // wanter id -> its index in sources
+    int numSources;
+
+    // Extra state for the lazy rounds (see matchAllLazy()) and for the
+    // searches in augmentEqualityPaths()
+    template <class HeapType> bool matchAllLazy();
+    template <class HeapType> void dijkstraLazy(HeapType *ptrHeap, unsigned int stamp);
+    QVector<unsigned int> reached; // last search in which each node was reached
+    unsigned int searchStamp;      // numbers the searches
+    QVector<int> settled;    // nodes extracted before the sink, in order
+    int numSettled;
+    QVector<int> stack;      // wanters on the current depth-first path
+    QVector<int> cursor;     // next arc to try from each wanter
+
+    // Used when the strongly connected components are solved separately (see
+    // matchComponents()). Each component gets a Graph of its own holding just
+    // the flat solver layout, which reports progress through the whole graph.
+    bool matchComponents();
+    void extractComponent(const QVector<int> &ids, const QVector<int> &localId, Graph *ptrPart);
+    static void solveComponent(Graph *&ptrPart);
+    Graph *ptrWhole;      // the graph this one is a component of, or NULL
+    QAtomicInt numMatched; // wanters matched so far, summed over components
+    int reportedMatched;  // how many of this component's matches were reported
+    bool solved;          // whether solveComponent() ran to completion
 };
 
 #endif // GRAPH_H
@@ -1,134 +1,501 @@
 #include "heap.h"
+#include <QtAlgorithms> // for qCountLeadingZeroBits()
 
-Entry::Entry(Node *ptrNode, quint64 cost)
+Entry::Entry()
 {
-  this->ptrNode = ptrNode;
-  this->cost    = cost;
-  ptrChild     = NULL;
-  ptrSibling   = NULL;
-  ptrPrev      = NULL;
-  used         = false;
+  cost    = 0;
+  child   = NO_ENTRY;
+  sibling = NO_ENTRY;
+  prev    = NO_ENTRY;
+  used    = false;
 }
 
 
-Heap::Heap()
+PairingHeap::PairingHeap()
 {
-  ptrRoot = NULL;
+  root = NO_ENTRY;
 }
 
-Heap::Heap(int expectedSize)
+PairingHeap::PairingHeap(int size)
 {
-  ptrRoot = NULL;
-  allocations.reserve(expectedSize);
+  root = NO_ENTRY;
+  resize(size);
 }
 
-Heap::~Heap()
+void PairingHeap::resize(int size)
 {
-  // deallocate everything added via insert()
-  while (!allocations.isEmpty())
-    delete allocations.takeFirst();
+  root = NO_ENTRY;
+  entries.resize(size);
 }
 
-bool Heap::isEmpty()
+void PairingHeap::clear()
 {
-  return ptrRoot == NULL;
+  root = NO_ENTRY;
+}
+
+bool PairingHeap::isEmpty()
+{
+  return root == NO_ENTRY;
 }
 
 
-Entry* Heap::extractMin()
+int PairingHeap::extractMin()
 {
-  Q_ASSERT(ptrRoot != NULL);
-  Entry *ptrMinEntry = ptrRoot;
-  Entry *ptrList = ptrRoot->ptrChild;
+  Q_ASSERT(root != NO_ENTRY);
+  Entry *e = entries.data();
+  int minEntry = root;
+  int list = e[root].child;
 
-  ptrRoot->used = true;
-  if (ptrList != NULL)
+  e[root].used = true;
+  if (list != NO_ENTRY)
   {
     // The (new) root can't have any siblings, so we re-merge them
-    while (ptrList->ptrSibling != NULL)
+    while (e[list].sibling != NO_ENTRY)
     {
-      Entry *ptrNextList = NULL;
-      while (ptrList != NULL  &&  ptrList->ptrSibling != NULL)
+      int nextList = NO_ENTRY;
+      while (list != NO_ENTRY  &&  e[list].sibling != NO_ENTRY)
       {
-        Entry *a = ptrList;
-        Entry *b = a->ptrSibling;
-        ptrList = b->ptrSibling;
+        int a = list;
+        int b = e[a].sibling;
+        list = e[b].sibling;
 
-        // link a and b and add result to ptrNextList
-        a->ptrSibling = b->ptrSibling = NULL;
+        // link a and b and add result to nextList
+        e[a].sibling = e[b].sibling = NO_ENTRY;
         a = merge(a,b);
-        a->ptrSibling = ptrNextList;
-        ptrNextList = a;
+        e[a].sibling = nextList;
+        nextList = a;
       }
-      if (ptrList == NULL)
-        ptrList = ptrNextList;
+      if (list == NO_ENTRY)
+        list = nextList;
       else
-        ptrList->ptrSibling = ptrNextList;
+        e[list].sibling = nextList;
     }
-    ptrList->ptrPrev = NULL; // separate this from the old root
+    e[list].prev = NO_ENTRY; // separate this from the old root
   }
-  ptrRoot = ptrList;
-  return ptrMinEntry; // return the old root (the smallest value)
+  root = list;
+  return minEntry; // return the old root (the smallest value)
 }
 
 
-// Create a new entry and merge it into root
-// The insert method returns the new Entry object, so that the user can
-// later call the decreaseCost method.
-Entry* Heap::insert(Node *ptrNode, quint64 cost)
+// Reset the node's entry and merge it into root. The entry can later be
+// passed to decreaseCost() by its node id.
+void PairingHeap::insert(int node, quint64 cost)
 {
-  Entry *ptrEntry = new Entry(ptrNode, cost);
-  ptrRoot = (ptrRoot==NULL) ? ptrEntry : merge(ptrEntry, ptrRoot);
-  allocations.append(ptrEntry);
-  return ptrEntry;
+  Entry *e = entries.data();
+  Q_ASSERT(node >= 0  &&  node < entries.size());
+  e[node].cost    = cost;
+  e[node].child   = NO_ENTRY;
+  e[node].sibling = NO_ENTRY;
+  e[node].prev    = NO_ENTRY;
+  e[node].used    = false;
+  root = (root==NO_ENTRY) ? node : merge(node, root);
 }
 
 
-void Heap::decreaseCost(Entry *ptrEntry, quint64 toCost)
+void PairingHeap::decreaseCost(int node, quint64 toCost)
 {
-  Q_ASSERT(!ptrEntry->used);
-  Q_ASSERT(toCost < ptrEntry->cost);
-  ptrEntry->cost = toCost;
+  Entry *e = entries.data();
+  Q_ASSERT(!e[node].used);
+  Q_ASSERT(toCost < e[node].cost);
+  e[node].cost = toCost;
 
   // Do we need to move this node? If not, then we're done
-  if (ptrEntry == ptrRoot || ptrEntry->cost >= ptrEntry->ptrPrev->cost)
+  int prev = e[node].prev;
+  if (node == root || toCost >= e[prev].cost)
     return;
 
   // Detach node from prev
-  if (ptrEntry == ptrEntry->ptrPrev->ptrChild)
-    ptrEntry->ptrPrev->ptrChild = ptrEntry->ptrSibling;
+  if (node == e[prev].child)
+    e[prev].child = e[node].sibling;
   else
   {
-    Q_ASSERT(ptrEntry == ptrEntry->ptrPrev->ptrSibling); // if this isn't prev's child, it must be the sibling;
-    ptrEntry->ptrPrev->ptrSibling = ptrEntry->ptrSibling;
+    Q_ASSERT(node == e[prev].sibling); // if this isn't prev's child, it must be the sibling;
+    e[prev].sibling = e[node].sibling;
   }
-  if (ptrEntry->ptrSibling != NULL)
-    ptrEntry->ptrSibling->ptrPrev = ptrEntry->ptrPrev;
-  ptrEntry->ptrPrev = NULL;
+  if (e[node].sibling != NO_ENTRY)
+    e[e[node].sibling].prev = prev;
+  e[node].prev = NO_ENTRY;
 
-  ptrRoot = merge(ptrEntry, ptrRoot);
+  root = merge(node, root);
 }
 
 
-Entry* Heap::merge(Entry *a,Entry *b)
+int PairingHeap::merge(int a, int b)
 {
-  Q_ASSERT(a != NULL  &&  b != NULL); // check parameter validity
+  Entry *e = entries.data();
+  Q_ASSERT(a != NO_ENTRY  &&  b != NO_ENTRY); // check parameter validity
 
   // Make sure that a's root <= b's root, swap if necessary
-  if (b->cost < a->cost)
+  if (e[b].cost < e[a].cost)
   {
-    Entry *tmp = a;
+    int tmp = a;
     a = b;
     b = tmp;
   }
 
   // Add b to a's children
-  b->ptrPrev = a;
-  b->ptrSibling = a->ptrChild;
-  if (b->ptrSibling != NULL)
-    b->ptrSibling->ptrPrev = b;
-  a->ptrChild = b;
+  e[b].prev = a;
+  e[b].sibling = e[a].child;
+  if (e[b].sibling != NO_ENTRY)
+    e[e[b].sibling].prev = b;
+  e[a].child = b;
 
   return a;
 }
 
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+
+QuadHeap::QuadHeap()
+{
+  count = 0;
+}
+
+QuadHeap::QuadHeap(int size)
+{
+  resize(size);
+}
+
+void QuadHeap::resize(int size)
+{
+  costs.resize(size);
+  slotOf.resize(size);
+  order.resize(size);
+  count = 0;
+}
+
+void QuadHeap::clear()
+{
+  count = 0;
+}
+
+bool QuadHeap::isEmpty()
+{
+  return count == 0;
+}
+
+
+int QuadHeap::extractMin()
+{
+  Q_ASSERT(count > 0);
+  int minNode = order.at(0);
+  count--;
+  if (count > 0)
+  {
+    // Move the last entry to the top and let it sink into place
+    order[0] = order.at(count);
+    slotOf[order.at(0)] = 0;
+    siftDown(0);
+  }
+  return minNode;
+}
+
+
+void QuadHeap::insert(int node, quint64 cost)
+{
+  Q_ASSERT(count < order.size());
+  costs[node] = cost;
+  order[count] = node;
+  slotOf[node] = count;
+  siftUp(count++);
+}
+
+
+void QuadHeap::decreaseCost(int node, quint64 toCost)
+{
+  Q_ASSERT(toCost < costs.at(node));
+  costs[node] = toCost;
+  siftUp(slotOf.at(node));
+}
+
+
+void QuadHeap::siftUp(int slot)
+{
+  int *o = order.data();
+  int *s = slotOf.data();
+  const quint64 *c = costs.constData();
+  int node = o[slot];
+
+  while (slot > 0)
+  {
+    int parent = (slot-1) >> 2;
+    if (c[o[parent]] <= c[node])
+      break;
+    o[slot] = o[parent]; // pull the parent down a level
+    s[o[slot]] = slot;
+    slot = parent;
+  }
+  o[slot] = node;
+  s[node] = slot;
+}
+
+
+void QuadHeap::siftDown(int slot)
+{
+  int *o = order.data();
+  int *s = slotOf.data();
+  const quint64 *c = costs.constData();
+  int node = o[slot];
+
+  for (;;)
+  {
+    int first = 4*slot + 1;
+    if (first >= count)
+      break;
+    // Find the cheapest of the (up to four) children
+    int best = first;
+    int end = (first+4 < count) ? first+4 : count;
+    for (int child=first+1; child<end; child++)
+      if (c[o[child]] < c[o[best]])
+        best = child;
+    if (c[o[best]] >= c[node])
+      break;
+    o[slot] = o[best]; // pull the child up a level
+    s[o[slot]] = slot;
+    slot = best;
+  }
+  o[slot] = node;
+  s[node] = slot;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+
+RadixHeap::RadixHeap()
+{
+  clear();
+}
+
+RadixHeap::RadixHeap(int size)
+{
+  resize(size);
+}
+
+void RadixHeap::resize(int size)
+{
+  costs.resize(size);
+  bucketOf.resize(size);
+  next.resize(size);
+  prev.resize(size);
+  clear();
+}
+
+void RadixHeap::clear()
+{
+  for (int b=0; b<65; b++)
+    head[b] = NO_ENTRY;
+  last = 0;
+  count = 0;
+}
+
+bool RadixHeap::isEmpty()
+{
+  return count == 0;
+}
+
+
+// Bucket 0 holds entries equal to the last extracted cost. Otherwise the
+// bucket is one more than the highest bit in which the cost differs from it.
+int RadixHeap::bucketFor(quint64 cost) const
+{
+  if (cost == last)
+    return 0;
+  return 64 - qCountLeadingZeroBits(cost ^ last);
+}
+
+void RadixHeap::link(int node, int bucket)
+{
+  bucketOf[node] = bucket;
+  prev[node] = NO_ENTRY;
+  next[node] = head[bucket];
+  if (head[bucket] != NO_ENTRY)
+    prev[head[bucket]] = node;
+  head[bucket] = node;
+}
+
+void RadixHeap::unlink(int node)
+{
+  if (prev.at(node) != NO_ENTRY)
+    next[prev.at(node)] = next.at(node);
+  else
+    head[bucketOf.at(node)] = next.at(node);
+  if (next.at(node) != NO_ENTRY)
+    prev[next.at(node)] = prev.at(node);
+}
+
+
+int RadixHeap::extractMin()
+{
+  Q_ASSERT(count > 0);
+  if (head[0] == NO_ENTRY)
+  {
+    // Find the lowest non-empty bucket and its cheapest entry
+    int b = 1;
+    while (head[b] == NO_ENTRY)
+      b++;
+    quint64 minCost = costs.at(head[b]);
+    for (int node=next.at(head[b]); node!=NO_ENTRY; node=next.at(node))
+      if (costs.at(node) < minCost)
+        minCost = costs.at(node);
+
+    // Advance to that cost and redistribute the bucket, whose entries all
+    // land in lower buckets
+    last = minCost;
+    int node = head[b];
+    head[b] = NO_ENTRY;
+    while (node != NO_ENTRY)
+    {
+      int nextNode = next.at(node);
+      link(node, bucketFor(costs.at(node)));
+      node = nextNode;
+    }
+  }
+
+  int minNode = head[0];
+  unlink(minNode);
+  count--;
+  return minNode;
+}
+
+
+void RadixHeap::insert(int node, quint64 cost)
+{
+  Q_ASSERT(cost >= last); // radix heaps only work for monotone costs
+  costs[node] = cost;
+  link(node, bucketFor(cost));
+  count++;
+}
+
+
+void RadixHeap::decreaseCost(int node, quint64 toCost)
+{
+  Q_ASSERT(toCost < costs.at(node));
+  Q_ASSERT(toCost >= last); // radix heaps only work for monotone costs
+  unlink(node);
+  costs[node] = toCost;
+  link(node, bucketFor(toCost));
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+
+BucketHeap::BucketHeap()
+{
+  head.resize(BUCKET_WINDOW+1);
+  clear();
+}
+
+BucketHeap::BucketHeap(int size)
+{
+  resize(size);
+}
+
+void BucketHeap::resize(int size)
+{
+  costs.resize(size);
+  bucketOf.resize(size);
+  next.resize(size);
+  prev.resize(size);
+  head.resize(BUCKET_WINDOW+1);
+  clear();
+}
+
+void BucketHeap::clear()
+{
+  head.fill(NO_ENTRY);
+  base = 0;
+  cursor = 0;
+  count = 0;
+}
+
+bool BucketHeap::isEmpty()
+{
+  return count == 0;
+}
+
+
+// Put the node in the bucket for its cost, or in the overflow list if the
+// cost lies beyond the window
+void BucketHeap::place(int node)
+{
+  quint64 cost = costs.at(node);
+  int bucket = (cost - base < BUCKET_WINDOW) ? (int)(cost & (BUCKET_WINDOW-1)) : BUCKET_WINDOW;
+
+  bucketOf[node] = bucket;
+  prev[node] = NO_ENTRY;
+  next[node] = head.at(bucket);
+  if (head.at(bucket) != NO_ENTRY)
+    prev[head.at(bucket)] = node;
+  head[bucket] = node;
+}
+
+void BucketHeap::unlink(int node)
+{
+  if (prev.at(node) != NO_ENTRY)
+    next[prev.at(node)] = next.at(node);
+  else
+    head[bucketOf.at(node)] = next.at(node);
+  if (next.at(node) != NO_ENTRY)
+    prev[next.at(node)] = prev.at(node);
+}
+
+
+int BucketHeap::extractMin()
+{
+  Q_ASSERT(count > 0);
+  for (;;)
+  {
+    // Scan the window for the next non-empty bucket
+    for (; cursor - base < BUCKET_WINDOW; cursor++)
+    {
+      int node = head.at((int)(cursor & (BUCKET_WINDOW-1)));
+      if (node != NO_ENTRY)
+      {
+        unlink(node);
+        count--;
+        return node;
+      }
+    }
+
+    // The window is empty, so move it up to the cheapest overflow entry
+    // and bring everything that now fits into the buckets
+    int node = head.at(BUCKET_WINDOW);
+    Q_ASSERT(node != NO_ENTRY);
+    quint64 minCost = costs.at(node);
+    for (; node!=NO_ENTRY; node=next.at(node))
+      if (costs.at(node) < minCost)
+        minCost = costs.at(node);
+    base = cursor = minCost;
+    node = head.at(BUCKET_WINDOW);
+    head[BUCKET_WINDOW] = NO_ENTRY;
+    while (node != NO_ENTRY)
+    {
+      int nextNode = next.at(node);
+      place(node);
+      node = nextNode;
+    }
+  }
+}
+
+
+void BucketHeap::insert(int node, quint64 cost)
+{
+  Q_ASSERT(cost >= cursor); // buckets are only scanned forward
+  costs[node] = cost;
+  place(node);
+  count++;
+}
+
+
+void BucketHeap::decreaseCost(int node, quint64 toCost)
+{
+  Q_ASSERT(toCost < costs.at(node));
+  Q_ASSERT(toCost >= cursor); // buckets are only scanned forward
+  unlink(node);
+  costs[node] = toCost;
+  place(node);
+}
@@ -1,45 +1,166 @@
 #ifndef HEAP_H
 #define HEAP_H
 
-#include <QList>  // for keeping track of allocations
-#include "graph.h"
+#include <QVector> // for the entry pools
 
-class Node; // forward declaration (graph.h)
+#define NO_ENTRY  (-1) // null link between entries
 
-// Priority queues are implemented as pairing heaps
+// All the priority queues below share one interface so that Graph::dijkstra()
+// can be instantiated for any of them:
+//   resize(size)             (re)allocate the pool for node ids 0..size-1
+//   clear()                  empty the queue, keeping the pool
+//   isEmpty()
+//   extractMin()             remove the cheapest entry and return its node id
+//   insert(node, cost)       reset the node's entry and add it to the queue
+//   decreaseCost(node, cost)
+//   cost(node)               the node's current (or final) cost
+// Each holds at most one entry per node id, allocates only in resize(), and
+// keeps every node's cost readable after the node has been extracted.
+//
+// Only the pairing heap reproduces TradeMaximizer's tie-breaking between
+// entries of equal cost. The others find matchings of the same (minimum)
+// cost, but may pick a different one when there are ties.
+typedef enum
+{
+  PAIRING_HEAP = 0, // TradeMaximizer-compatible; the default
+  QUAD_HEAP    = 1, // indexed 4-ary heap
+  RADIX_HEAP   = 2, // monotone radix heap over 64-bit costs
+  BUCKET_HEAP  = 3, // Dial's buckets with an overflow list
+  AUTO_HEAP    = 4, // BUCKET for lazy rounds over small costs, else RADIX
+} HEAP_TYPE;
+
+// The bucket heap keeps a sliding window of this many one-cost buckets
+#define BUCKET_WINDOW  4096
 
-// Entry is the type of nodes in the skew heap.
+
+// Entry is the type of nodes in the pairing heap. Entries live in a pool
+// owned by the heap and are addressed by the id of the graph node they
+// belong to, so the links between them are pool indices instead of pointers.
 class Entry
 {
   public:
-    Entry(Node *ptrNode,quint64 cost);
-    Node  *ptrNode; // the node with which this entry is associated
+    Entry();
     quint64 cost;   // the current cost of the vertex in the dijkstra algorithm
 
-    // These are used by the Heap class
-    Entry *ptrChild;
-    Entry *ptrSibling;
-    Entry *ptrPrev; // parent if first child, else previous sibling
-    bool used;      // flag for marking the entry as removed from the heap
+    // These are used by the PairingHeap class
+    int child;
+    int sibling;
+    int prev;  // parent if first child, else previous sibling
+    bool used; // flag for marking the entry as removed from the heap
+};
+
+
+// The pool is allocated once by resize() and every insert() resets an entry
+// in place, so a heap can be cleared and refilled for each Dijkstra round
+// without touching the allocator.
+class PairingHeap
+{
+  public:
+    PairingHeap();
+    PairingHeap(int size);
+    void resize(int size);
+    void clear();
+    bool isEmpty();
+    int extractMin();
+    void insert(int node, quint64 cost);
+    void decreaseCost(int node, quint64 toCost);
+    quint64 cost(int node) const { return entries.at(node).cost; }
+
+  private:
+    int merge(int a, int b);
+
+    QVector<Entry> entries; // entry pool, indexed by node id
+    int root;
+};
+
+
+// An implicit 4-ary heap of node ids plus each node's position in it. The
+// wider fan-out makes it shallower than a binary heap and keeps siblings in
+// one cache line.
+class QuadHeap
+{
+  public:
+    QuadHeap();
+    QuadHeap(int size);
+    void resize(int size);
+    void clear();
+    bool isEmpty();
+    int extractMin();
+    void insert(int node, quint64 cost);
+    void decreaseCost(int node, quint64 toCost);
+    quint64 cost(int node) const { return costs.at(node); }
+
+  private:
+    void siftUp(int slot);
+    void siftDown(int slot);
+
+    QVector<quint64> costs; // indexed by node id
+    QVector<int> slotOf;    // node id -> slot in order[]
+    QVector<int> order;     // the heap itself, holding node ids
+    int count;
+};
+
+
+// A radix heap relies on Dijkstra never inserting a cost below the last one
+// extracted. Entries sit in bucket i when their cost first differs from that
+// last cost in bit i-1, so each entry only ever moves to lower buckets and
+// no comparisons are needed outside of the bucket being emptied.
+class RadixHeap
+{
+  public:
+    RadixHeap();
+    RadixHeap(int size);
+    void resize(int size);
+    void clear();
+    bool isEmpty();
+    int extractMin();
+    void insert(int node, quint64 cost);
+    void decreaseCost(int node, quint64 toCost);
+    quint64 cost(int node) const { return costs.at(node); }
+
+  private:
+    int bucketFor(quint64 cost) const;
+    void link(int node, int bucket);
+    void unlink(int node);
+
+    QVector<quint64> costs; // indexed by node id
+    QVector<int> bucketOf;  // node id -> bucket holding it
+    QVector<int> next, prev; // intrusive bucket lists, by node id
+    int head[65];
+    quint64 last; // the most recently extracted cost
+    int count;
 };
 
 
-class Heap
+// Dial's algorithm: entries whose cost falls in the window
+// [base, base+BUCKET_WINDOW) are kept in one bucket per cost and are found by
+// scanning forward from the last extracted cost. Costlier entries wait in an
+// overflow list until the window runs dry and is moved up to the cheapest of
+// them. This only pays off when most arc costs fit in the window.
+class BucketHeap
 {
   public:
-    Heap();
-    Heap(int expectedSize);
-    ~Heap();
+    BucketHeap();
+    BucketHeap(int size);
+    void resize(int size);
+    void clear();
     bool isEmpty();
-    Entry* extractMin();
-    Entry* insert(Node *ptrNode, quint64 cost); // Create a new entry and merge it into root
-    void decreaseCost(Entry *ptrEntry, quint64 toCost);
+    int extractMin();
+    void insert(int node, quint64 cost);
+    void decreaseCost(int node, quint64 toCost);
+    quint64 cost(int node) const { return costs.at(node); }
 
   private:
-    Entry* merge(Entry *a,Entry *b);
+    void place(int node);
+    void unlink(int node);
 
-    Entry *ptrRoot;
-    QList<Entry*> allocations;
+    QVector<quint64> costs; // indexed by node id
+    QVector<int> bucketOf;  // node id -> bucket (BUCKET_WINDOW is the overflow list)
+    QVector<int> next, prev; // intrusive bucket lists, by node id
+    QVector<int> head;      // BUCKET_WINDOW buckets plus the overflow list
+    quint64 base;   // lowest cost the window can hold
+    quint64 cursor; // the most recently extracted cost
+    int count;
 };
 
 #endif // HEAP_H
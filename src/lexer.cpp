@@ -0,0 +1,209 @@
+#include "lexer.h"
+#include <QtAlgorithms> // for qCountTrailingZeroBits()
+#include <string.h>     // for memcpy()
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LEX_BLOCK 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LEX_BLOCK 16
+#else
+#define LEX_BLOCK 8
+#endif
+
+// One bit per byte of a block, for each kind of byte
+typedef struct
+{
+  quint64 high;  // not ASCII
+  quint64 open, close, colon, semi;
+  quint64 space; // ' '
+  quint64 other; // the other whitespace, '\t' to '\r'
+} BlockMasksType;
+
+static void lexBlock(const char *src, char *dst, bool upper, BlockMasksType &masks);
+static void markFirstLast(quint64 mask, int pos, int &first, int &last);
+static void markFirst(quint64 mask, int pos, int &first);
+
+
+WantLexer::WantLexer()
+{
+  len = 0;
+}
+
+
+// Scans len bytes of line. Returns false as soon as it finds a byte that
+// isn't ASCII, since those lines are left to QString.
+bool WantLexer::lex(const char *line, int len, bool upper)
+{
+  this->len = len;
+  int numWords = len/64 + 1;
+  folded.resize(len + LEX_BLOCK);
+  skipBits.fill(0, numWords);
+  semiBits.fill(0, numWords);
+  firstOpen = lastOpen = -1;
+  firstClose = lastClose = -1;
+  firstColon = lastColon = -1;
+  firstSemi = firstSpace = firstOtherSpace = -1;
+
+  char *dst = folded.data();
+  for (int pos = 0; pos < len; pos += LEX_BLOCK)
+  {
+    // Pad the last block with NULs, which aren't any kind of byte
+    const char *src = line + pos;
+    char tail[LEX_BLOCK];
+    if (len - pos < LEX_BLOCK)
+    {
+      memset(tail, 0, LEX_BLOCK);
+      memcpy(tail, src, len - pos);
+      src = tail;
+    }
+
+    BlockMasksType masks;
+    lexBlock(src, dst + pos, upper, masks);
+    if (masks.high != 0)
+      return false;
+    markFirstLast(masks.open,  pos, firstOpen,  lastOpen);
+    markFirstLast(masks.close, pos, firstClose, lastClose);
+    markFirstLast(masks.colon, pos, firstColon, lastColon);
+    markFirst(masks.semi,  pos, firstSemi);
+    markFirst(masks.space, pos, firstSpace);
+    markFirst(masks.other, pos, firstOtherSpace);
+
+    // A block never straddles two words, since LEX_BLOCK divides 64
+    skipBits[pos/64] |= (masks.space | masks.other | masks.colon) << (pos%64);
+    semiBits[pos/64] |= masks.semi << (pos%64);
+  }
+  return true;
+}
+
+
+// Skips any whitespace and colons from pos, and returns where the token
+// there starts, or -1 at the end of the line. Sets pos to just after it.
+int WantLexer::nextToken(int &pos) const
+{
+  int start = findNot(skipBits, pos);
+  if (start >= len)
+    return -1;
+  if (semiBits.at(start/64) & (Q_UINT64_C(1) << (start%64)))
+    pos = start + 1; // a semicolon is a token by itself
+  else
+    pos = qMin(findEither(skipBits, semiBits, start), len);
+  return start;
+}
+
+
+// Returns the first bit at or after pos that is clear in bits
+int WantLexer::findNot(const QVector<quint64> &bits, int pos) const
+{
+  int word = pos/64;
+  quint64 clear = ~bits.at(word) & (~Q_UINT64_C(0) << (pos%64));
+  while (clear == 0)
+  {
+    if (++word == bits.size())
+      return len;
+    clear = ~bits.at(word);
+  }
+  return word*64 + qCountTrailingZeroBits(clear);
+}
+
+
+// Returns the first bit at or after pos that is set in bits or moreBits
+int WantLexer::findEither(const QVector<quint64> &bits, const QVector<quint64> &moreBits, int pos) const
+{
+  int word = pos/64;
+  quint64 set = (bits.at(word) | moreBits.at(word)) & (~Q_UINT64_C(0) << (pos%64));
+  while (set == 0)
+  {
+    if (++word == bits.size())
+      return len;
+    set = bits.at(word) | moreBits.at(word);
+  }
+  return word*64 + qCountTrailingZeroBits(set);
+}
+
+
+// Local functions follow -------------------------------------------------------
+
+// Classifies the LEX_BLOCK bytes at src, and copies them to dst, folding
+// them to upper case if asked. Only ASCII letters are folded, which is all
+// QString::toUpper() would change on a line that's all ASCII.
+static void lexBlock(const char *src, char *dst, bool upper, BlockMasksType &masks)
+{
+#if defined(__AVX2__)
+  __m256i v = _mm256_loadu_si256((const __m256i*)src);
+  __m256i ctrl = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+  masks.high  = (quint32)_mm256_movemask_epi8(v);
+  masks.open  = (quint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('(')));
+  masks.close = (quint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(')')));
+  masks.colon = (quint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')));
+  masks.semi  = (quint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(';')));
+  masks.space = (quint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+  masks.other = (quint32)_mm256_movemask_epi8(   // '\t' <= c <= '\r', unsigned
+        _mm256_cmpeq_epi8(_mm256_min_epu8(ctrl, _mm256_set1_epi8(4)), ctrl));
+  if (upper)
+  {
+    __m256i letter = _mm256_sub_epi8(v, _mm256_set1_epi8('a'));
+    __m256i isLower = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(25)), letter);
+    v = _mm256_sub_epi8(v, _mm256_and_si256(isLower, _mm256_set1_epi8(0x20)));
+  }
+  _mm256_storeu_si256((__m256i*)dst, v);
+#elif defined(__SSE2__)
+  __m128i v = _mm_loadu_si128((const __m128i*)src);
+  __m128i ctrl = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+  masks.high  = _mm_movemask_epi8(v);
+  masks.open  = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('(')));
+  masks.close = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(')')));
+  masks.colon = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+  masks.semi  = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(';')));
+  masks.space = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+  masks.other = _mm_movemask_epi8(   // '\t' <= c <= '\r', unsigned
+        _mm_cmpeq_epi8(_mm_min_epu8(ctrl, _mm_set1_epi8(4)), ctrl));
+  if (upper)
+  {
+    __m128i letter = _mm_sub_epi8(v, _mm_set1_epi8('a'));
+    __m128i isLower = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(25)), letter);
+    v = _mm_sub_epi8(v, _mm_and_si128(isLower, _mm_set1_epi8(0x20)));
+  }
+  _mm_storeu_si128((__m128i*)dst, v);
+#else
+  masks.high = masks.open = masks.close = masks.colon = 0;
+  masks.semi = masks.space = masks.other = 0;
+  for (int idx = 0; idx < LEX_BLOCK; idx++)
+  {
+    uchar c = src[idx];
+    quint64 bit = Q_UINT64_C(1) << idx;
+    switch (c)
+    {
+      case '(': masks.open  |= bit; break;
+      case ')': masks.close |= bit; break;
+      case ':': masks.colon |= bit; break;
+      case ';': masks.semi  |= bit; break;
+      case ' ': masks.space |= bit; break;
+      default:
+        if (c >= 0x80)
+          masks.high |= bit;
+        else if (c >= '\t' && c <= '\r')
+          masks.other |= bit;
+    }
+    dst[idx] = (upper && c >= 'a' && c <= 'z') ? c - 0x20 : c;
+  }
+#endif
+}
+
+
+static void markFirstLast(quint64 mask, int pos, int &first, int &last)
+{
+  if (mask == 0)
+    return;
+  if (first == -1)
+    first = pos + qCountTrailingZeroBits(mask);
+  last = pos + 63 - qCountLeadingZeroBits(mask);
+}
+
+
+static void markFirst(quint64 mask, int pos, int &first)
+{
+  if (mask != 0  &&  first == -1)
+    first = pos + qCountTrailingZeroBits(mask);
+}
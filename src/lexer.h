@@ -0,0 +1,39 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <QVector> // for the bitmaps and the folded line
+
+// Scans a want list line for the characters the parser checks, in blocks of
+// 16 or 32 bytes at a time with SSE2 or AVX2 (or 8 at a time without), and
+// folds it to upper case in the same pass. Then it hands out the tokens of
+// the line, which are separated by whitespace and colons, with each
+// semicolon a token by itself. One lexer is reused for many lines, so it
+// only allocates when a line is longer than any before it.
+class WantLexer
+{
+  public:
+    WantLexer();
+    bool lex(const char *line, int len, bool upper); // false unless plain ASCII
+    int nextToken(int &pos) const; // start of the token at or after pos, or -1
+    const char *text() const { return folded.constData(); } // the folded line
+    int length() const { return len; }
+
+    // Positions in the line, or -1 if there are none
+    int firstOpen, lastOpen;     // '('
+    int firstClose, lastClose;   // ')'
+    int firstColon, lastColon;   // ':'
+    int firstSemi;               // ';'
+    int firstSpace;              // ' '
+    int firstOtherSpace;         // any other whitespace
+
+  private:
+    int findNot(const QVector<quint64> &bits, int pos) const;
+    int findEither(const QVector<quint64> &bits, const QVector<quint64> &moreBits, int pos) const;
+
+    int len;
+    QVector<char> folded;
+    QVector<quint64> skipBits; // whitespace and colons, one bit per byte
+    QVector<quint64> semiBits; // semicolons
+};
+
+#endif // LEXER_H
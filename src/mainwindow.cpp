@@ -23,8 +23,8 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->urlButton,    &QPushButton::pressed, this, &MainWindow::pullUrl);
     connect(&webCtrl, &QNetworkAccessManager::finished, this, &MainWindow::downloaded);
 
-    keepRunning = false;
-    paused = false;
+    keepRunning.storeRelease(0);
+    paused.storeRelease(0);
     ptrExec = NULL;
 
     setAcceptDrops(true);
@@ -33,8 +33,8 @@ MainWindow::MainWindow(QWidget *parent) :
 
 MainWindow::~MainWindow()
 {
-    keepRunning = false;
-    paused = false;
+    keepRunning.storeRelease(0);
+    paused.storeRelease(0);
     delete ui;
 }
 
@@ -73,6 +73,11 @@ void MainWindow::setBarVal(int val)
   ui->progressBar->setValue(val);
 }
 
+void MainWindow::inputError(QString str)
+{
+  QMessageBox::critical(this, "Input Error", str);
+}
+
 void MainWindow::runComplete(QString results)
 {
   ui->progressBar->setEnabled(false);
@@ -85,9 +90,9 @@ void MainWindow::runComplete(QString results)
   displayTxt(results);
   delete ptrExec;
   ptrExec = NULL;
-  if (!keepRunning)
+  if (!keepRunning.loadAcquire())
     ui->progressBar->reset();
-  keepRunning = false;
+  keepRunning.storeRelease(0);
 }
 
 
@@ -98,21 +103,39 @@ void MainWindow::runButtonPressed()
 {
   if (ui->runButton->text() == "Pause")
   {
-    paused = true;
+    paused.storeRelease(1);
     ui->progressBar->setEnabled(false);
     ui->runButton->setText("Resume");
     return;
   }
   if (ui->runButton->text() == "Resume")
   {
-    paused = false;
+    paused.storeRelease(0);
     ui->progressBar->setEnabled(true);
     ui->runButton->setText("Pause");
     return;
   }
 
-  keepRunning = true;
-  paused = false;
+  // Map the want list file rather than reading it into memory. It only
+  // has to stay mapped until go() has parsed it.
+  QFile file(filePath);
+  QByteArray data = input;
+  if (!filePath.isEmpty())
+  {
+    if (!file.open(QIODevice::ReadOnly))
+    {
+      QMessageBox::critical(this, "Error", "Could not open file");
+      return;
+    }
+    uchar *ptrMap = (file.size() > 0) ? file.map(0, file.size()) : NULL;
+    if (ptrMap != NULL)
+      data = QByteArray::fromRawData((const char*)ptrMap, file.size());
+    else
+      data = file.readAll(); // can't be mapped, so read it instead
+  }
+
+  keepRunning.storeRelease(1);
+  paused.storeRelease(0);
   ui->runButton->setText("Pause");
   ui->stopButton->setEnabled(true);
   ui->progressBar->setEnabled(true);
@@ -121,7 +144,8 @@ void MainWindow::runButtonPressed()
   ui->saveButton->setEnabled(false);
 
   ptrExec = new Exec(this);
-  ptrExec->go(input, filename, &keepRunning, &paused);
+  ptrExec->go(data, filename, &keepRunning, &paused);
+  // (closing the file unmaps it)
 }
 
 void MainWindow::stopButtonPressed()
@@ -130,8 +154,8 @@ void MainWindow::stopButtonPressed()
   ui->progressBar->reset();
   ui->runButton->setEnabled(false);
   ui->stopButton->setEnabled(false);
-  paused = false; // unpause threads so they can exit
-  keepRunning = false;
+  paused.storeRelease(0); // unpause threads so they can exit
+  keepRunning.storeRelease(0);
 }
 
 void MainWindow::saveButtonPressed()
@@ -182,7 +206,8 @@ void MainWindow::pullUrl()
 void MainWindow::downloaded(QNetworkReply* ptrReply)
 {
   ptrReply->deleteLater(); // mark for deletion after signal completes
-  input = QString(ptrReply->readAll());
+  input = ptrReply->readAll();
+  filePath = "";
   if (!input.isEmpty())
   {
     ui->runButton->setEnabled(true);
@@ -207,7 +232,8 @@ void MainWindow::readFile()
   if (filename == "")
     return;
 
-  input = "";
+  input.clear();
+  filePath = "";
   ui->runButton->setEnabled(false);
   if (!file.open(QIODevice::ReadOnly))
   {
@@ -216,8 +242,8 @@ void MainWindow::readFile()
     QMessageBox::critical(this, "Error", "Could not open file");
     return;
   }
-  input = QString(file.readAll());
   file.close();
+  filePath = filename; // it's read when it's run (see runButtonPressed())
   ui->runButton->setEnabled(true);
   ui->statusLabel->setText("File Loaded");
 
@@ -6,11 +6,12 @@
 #include <QNetworkRequest>       // for pulling want from
 #include <QNetworkReply>         // online.
 #include "exec.h"
+#include "reporter.h"
 
 namespace Ui { class MainWindow; }
 class Exec;
 
-class MainWindow : public QMainWindow
+class MainWindow : public QMainWindow, public Reporter
 {
   Q_OBJECT
 
@@ -24,6 +25,7 @@ class MainWindow : public QMainWindow
     void displayStats(QString status, QString users, QString real, QString viable, QString trades, QString iter);
     void setBarFormat(QString fmt, int max);
     void setBarVal(int val);
+    void inputError(QString str);
 
   private slots:
     void browseFile();
@@ -41,9 +43,10 @@ class MainWindow : public QMainWindow
 
     Ui::MainWindow *ui;
     Exec *ptrExec;
-    QString input;
+    QByteArray input; // downloaded want lists
+    QString filePath; // or the want list file, which is mapped when run
     QString filename;
-    bool keepRunning, paused;
+    QAtomicInt keepRunning, paused; // read by the solver threads
 
     // Used for downloading wants
     QNetworkAccessManager webCtrl;
@@ -1,121 +1,108 @@
 #include "metric.h"
 #include <QString> // for returning strings
+#include <QSet>    // for counting users
 
-static METRIC_TYPE lastMetricType;
-static QString sMetString;
+static int calcSumOfSquares(CyclesType *ptrCycles, QString *ptrMetString);
+static int calcUsersTrading(CyclesType *ptrCycles, QString *ptrMetString);
+static int calcUsersSumOfSquares(CyclesType *ptrCycles, QString *ptrMetString);
+static int calcCombineShipping(CyclesType *ptrCycles, QString *ptrMetString);
 
-static int calcSumOfSquares(CyclesType *ptrCycles);
-static int calcUsersTrading(CyclesType *ptrCycles);
-static int calcUsersSumOfSquares(CyclesType *ptrCycles);
-static int calcCombineShipping(CyclesType *ptrCycles);
 
 
-
-QString metricString(METRIC_TYPE metricType)
+// Returns the function that computes the given metric for a set of cycles
+// (lower is better), so the choice is made once instead of for every
+// result. The function describes the metric in ptrMetString if one is
+// given, and otherwise skips building the description. There's no shared
+// state, so worker threads can call it concurrently.
+MetricFunction metricFunction(METRIC_TYPE metricType)
 {
-  if (lastMetricType != metricType)
-    return "Error: Metric was never computed or type has changed";
-  return sMetString; // Report back the string put together earlier
-}
-
-
-int calculateMetric(CyclesType *ptrCycles, METRIC_TYPE metricType)
-{
-  int ret;
-
-  if (ptrCycles == NULL)
-    return 0;
-
-  lastMetricType = metricType;
   switch (metricType)
   {
-    case CHAIN_SIZES_SOS:   ret = calcSumOfSquares(ptrCycles);      break;
-    case USERS_TRADING:     ret = calcUsersTrading(ptrCycles);      break;
-    case USERS_SOS:         ret = calcUsersSumOfSquares(ptrCycles); break;
-    case COMBINE_SHIPPING:  ret = calcCombineShipping(ptrCycles);   break;
-    default:
-      Q_ASSERT(false);
-      ret = -1;
+    case CHAIN_SIZES_SOS:   return calcSumOfSquares;
+    case USERS_TRADING:     return calcUsersTrading;
+    case USERS_SOS:         return calcUsersSumOfSquares;
+    case COMBINE_SHIPPING:  return calcCombineShipping;
   }
-  return ret;
+  Q_ASSERT(false);
+  return calcSumOfSquares;
 }
 
 
-static int calcSumOfSquares(CyclesType *ptrCycles)
+static int calcSumOfSquares(CyclesType *ptrCycles, QString *ptrMetString)
 {
   int sum = 0;
-  QList<int> groups;
-  //groups.reserve(ptrCycles->size());
 
   for(int idx=0; idx<ptrCycles->size(); idx++)
-  {
     sum += ptrCycles->at(idx)->size() * ptrCycles->at(idx)->size();
+  if (ptrMetString == NULL)
+    return sum;
+
+  QList<int> groups;
+  for(int idx=0; idx<ptrCycles->size(); idx++)
     groups.append(ptrCycles->at(idx)->size());
-  }
   std::sort(groups.begin(), groups.end());
-  sMetString = "[ " + QString::number(sum) + " :";
+  QString metString = "[ " + QString::number(sum) + " :";
   for (int j = groups.size()-1; j >= 0; j--)
-    sMetString = sMetString + " " + QString::number(groups.at(j));
+    metString = metString + " " + QString::number(groups.at(j));
 
-  sMetString += " ]";
+  *ptrMetString = metString + " ]";
   return sum;
 }
 
 
-static int calcUsersTrading(CyclesType *ptrCycles)
+static int calcUsersTrading(CyclesType *ptrCycles, QString *ptrMetString)
 {
-  QStringList users;
+  QSet<int> users;
   int count;
 
   for(int idx=0; idx<ptrCycles->size(); idx++)
     for(int j=0; j<ptrCycles->at(idx)->size(); j++)
     {
-      QString name = ptrCycles->at(idx)->at(j).owner;
-      if (!users.contains(name))
-        users.append(name);
+      users.insert(ptrCycles->at(idx)->at(j).ownerId);
     }
 
   count = users.size();
 
-  sMetString = "[ users trading = " + QString::number(count) + " ]";
+  if (ptrMetString != NULL)
+    *ptrMetString = "[ users trading = " + QString::number(count) + " ]";
   return -count;
 }
 
 
-static int calcUsersSumOfSquares(CyclesType *ptrCycles)
+static int calcUsersSumOfSquares(CyclesType *ptrCycles, QString *ptrMetString)
 {
-  QHash<QString,int> users;
-  QHash<QString,int>::iterator iter;
+  QHash<int,int> users;
+  QHash<int,int>::iterator iter;
   int sum = 0;
 
   for(int idx=0; idx<ptrCycles->size(); idx++)
     for(int j=0; j<ptrCycles->at(idx)->size(); j++)
     {
-      QString name = ptrCycles->at(idx)->at(j).owner;
-      users[name] = 1 + users.value(name,0);
+      int owner = ptrCycles->at(idx)->at(j).ownerId;
+      users[owner] = 1 + users.value(owner,0);
     }
 
-  sMetString = "[ users trading = " + QString::number(users.size());
-
   for (iter = users.begin(); iter != users.end(); iter++)
     sum += iter.value() * iter.value();
 
-  sMetString += ", sum of squares = " + QString::number(sum) + " ]";
+  if (ptrMetString != NULL)
+    *ptrMetString = "[ users trading = " + QString::number(users.size()) +
+                    ", sum of squares = " + QString::number(sum) + " ]";
   return sum;
 }
 
 
-static int calcCombineShipping(CyclesType *ptrCycles)
+static int calcCombineShipping(CyclesType *ptrCycles, QString *ptrMetString)
 {
-  QHash<QString,int> pairs;
-  QHash<QString,int>::iterator iter;
+  QHash<quint64,int> pairs; // (receiving owner, sending owner) -> count
+  QHash<quint64,int>::iterator iter;
   int count = 0;
 
   for(int idx=0; idx<ptrCycles->size(); idx++)
     for(int j=0; j<ptrCycles->at(idx)->size(); j++)
     {
-      Node n = ptrCycles->at(idx)->at(j);
-      QString key  = n.owner + " receives " + n.ptrMatch->ptrTwin->owner;
+      const Node &n = ptrCycles->at(idx)->at(j);
+      quint64 key = ((quint64)(quint32)n.ownerId << 32) | (quint32)n.ptrMatch->ptrTwin->ownerId;
       pairs[key] = 1 + pairs.value(key,0);
     }
 
@@ -123,7 +110,8 @@ static int calcCombineShipping(CyclesType *ptrCycles)
     if (iter.value() > 1)
       count += iter.value()-1;
 
-  sMetString = "[ combine shipping = " + QString::number(count) + " ]";
+  if (ptrMetString != NULL)
+    *ptrMetString = "[ combine shipping = " + QString::number(count) + " ]";
   return -count;
 }
 
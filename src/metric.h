@@ -1,10 +1,12 @@
 #ifndef METRIC_H
 #define METRIC_H
 
-#include "parser.h" // for METRIC_TYPE
 #include "graph.h"  // for CyclesType
+#include "parser.h" // for METRIC_TYPE
+
+// Computes a metric for a set of cycles (see metricFunction())
+typedef int (*MetricFunction)(CyclesType *ptrCycles, QString *ptrMetString);
 
-QString metricString(METRIC_TYPE metricType);
-int calculateMetric(CyclesType *ptrCycles, METRIC_TYPE metricType);
+MetricFunction metricFunction(METRIC_TYPE metricType);
 
 #endif // METRIC_H
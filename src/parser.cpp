@@ -1,142 +1,168 @@
 #include "parser.h"
-#include <QMessageBox>  // for displaying critical errors
-#include <QApplication> // for updating the display
+#include <QCoreApplication> // for updating the display
+#include <QtConcurrent> // for parsing and building in parallel
+#include <QThreadStorage> // for findWants()
+#include <algorithm>    // for counting lines
+#include <string.h>     // for memchr()
+#include "lexer.h"      // for tokenizing want lists
 
+#define PARSE_CHUNK_BYTES  65536 // the least input worth parsing on a thread of its own
+#define BUILD_CHUNK_LISTS  256   // the fewest want lists worth a thread of their own
+#define CHUNKS_PER_THREAD  8     // more chunks than threads evens out the load
+
+// Results of parseWantsView()
+typedef enum
+{
+  VIEW_PARSED,   // the line was a want list, and was added
+  VIEW_FAILED,   // the line had a fatal error
+  VIEW_FALLBACK  // the line has to be handled as a QString instead
+} ViewResult;
+
+// QChar::isSpace(), for ASCII characters
+#define IS_SPACE(c)  ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+
+// A run of whole lines from the want list section of the input, which
+// parseChunk() parses on a thread of its own. It interns the tokens into
+// its own symbol table, and they're renumbered into gSymbols when the
+// chunks are merged.
+typedef struct
+{
+  const char *begin, *end;  // the lines, in the input
+  bool hasOfficialNames;    // for reporting a late !BEGIN-OFFICIAL-NAMES
+  QAtomicInt *ptrProgress;  // lines parsed so far, over all the chunks
+  SymbolTable symbols;
+  QList< QVector<int> > wantLists; // as ids in symbols
+  int numLines;             // lines parsed, up to and including any error
+  QString error;            // the first fatal error, if any
+  WantLexer lexer;          // reused for every line
+} ParseChunkType;
+
+// What the node pass of buildGraph() found out about a want list's item
+typedef struct
+{
+  int ownerId;     // or EMPTY_SYMBOL
+  QString name;    // with " for user OWNER" for a dummy item
+  bool isDummy;
+  bool isOfficial; // whether it's one of the official names
+  QString error;   // a problem with a dummy item, if any
+} ItemType;
+
+// A wanted item, found by the edge pass of buildGraph()
+typedef struct
+{
+  Node *ptrSender;
+  quint64 cost;
+} WantType;
+
+// The items a want list has wanted so far, for finding repeats. Each
+// thread running findWants() has its own, and each want list gets a new
+// generation, so nothing has to be cleared between lists.
+typedef struct
+{
+  QVector<quint32> stamps; // by name id, the generation that last wanted it
+  quint32 generation;
+} WantMarksType;
+
+// A run of want lists, which each pass of buildGraph() handles on a thread
+// of its own. The passes only read the graph. They leave their results in
+// their chunks, and the chunks are merged in order afterwards, so the graph
+// and the errors come out just as if the want lists were done one by one.
+typedef struct
+{
+  int first, last;          // want lists first up to last-1
+  ParseDataType *ptrParsed;
+  Graph *ptrGraph;
+  QAtomicInt *ptrProgress;  // want lists done so far, over all the chunks
+  QVector<ItemType> items;  // from the node pass (see findItems())
+  QVector<WantType> wants;  // from the edge pass (see findWants())...
+  QVector<int> numWants;    // ...and how many are from each want list
+  QStringList errors;       // ditto
+  QHash<QString,int> unknownNames; // ditto
+} BuildChunkType;
+
+typedef void (*BuildPassType)(BuildChunkType &chunk); // a pass of buildGraph()
+
+static bool parseWantLists(Reporter *ptrReporter, const char *begin, const char *end,
+                           int firstLine, ParseDataType &parsed);
+static void parseChunk(ParseChunkType &chunk);
+static ViewResult parseWantsView(const char *begin, const char *end, ParseChunkType &chunk);
+static bool parseWantsString(QString line, ParseChunkType &chunk);
+static ViewResult viewError(ParseChunkType &chunk, QString str);
+static bool wantError(ParseChunkType &chunk, QString str);
+static int internToken(SymbolTable &symbols, const char *str, int len, bool isUsername);
+static QList<BuildChunkType> buildChunks(ParseDataType &parsed, Graph &graph, QAtomicInt *ptrProgress);
+static void findItems(BuildChunkType &chunk);
+template <PRIORITY_TYPE SCHEME>
+static void findWants(BuildChunkType &chunk);
+static BuildPassType wantsPass(PRIORITY_TYPE scheme);
+template <PRIORITY_TYPE SCHEME>
+static inline quint64 rankCost(quint64 rank);
+template <class ChunkType>
+static void runChunks(Reporter *ptrReporter, QList<ChunkType> &chunks, void (*function)(ChunkType&),
+                      QAtomicInt *ptrProgress, int base);
 static void setDefaultOptions( QHash<QString, OptionType> &options );
+static bool parseOptions(Reporter *ptrReporter, QString line, int lineNumber);
 static void setOption(QString optName, bool enabled, QString name, int val=0);
-static bool fatalError(QWidget *parent, QString str, int line);
+static void resolveOptions();
+static bool fatalError(Reporter *ptrReporter, QString str, int line);
 
 QHash<QString, OptionType> gOptions;
+SettingsType gSettings; // the options most used, kept up to date by resolveOptions()
+static QThreadStorage<WantMarksType> gWantMarks; // for findWants()
+SymbolTable gSymbols; // every item name and username, interned by parseInput()
 
-bool parseInput(MainWindow *parent, QString input, ParseDataType &parsed)
+// Reads the input in place, which is usually a memory-mapped file (see
+// MainWindow::runButtonPressed()). The options and official names are read
+// here line by line. The want lists that follow them are parsed in chunks
+// on all cores by parseWantLists(). Any extraOptions, e.g., from the command
+// line, are read as if they were a line of options before the input.
+bool parseInput(Reporter *ptrReporter, const QByteArray &input, ParseDataType &parsed,
+                QString extraOptions)
 {
   QString line;
   int lineNumber=0;
   bool readingOfficialNames = false;
-  QStringList inputLines = input.split("\n");
+  const char *wantsBegin = NULL; // where the want lists start...
+  int wantsLine = 0;             // ...and on which line
+  // Like QString(input), stop at the first NUL
+  const char *pos = input.constData();
+  const char *end = pos + qstrnlen(pos, input.size());
+  int numLines = 1 + (int)std::count(pos, end, '\n');
 
-  parent->setBarFormat("Parsing input %v / %m", inputLines.size());
+  ptrReporter->setBarFormat("Parsing input %v / %m", numLines);
   setDefaultOptions( gOptions ); // set options to their default values
+  resolveOptions();
+  gSymbols.clear();
+  if (!extraOptions.trimmed().isEmpty()  &&  !parseOptions(ptrReporter, "#!"+extraOptions, 0))
+    return false;
 
-  while (lineNumber < inputLines.size())
+  while (lineNumber < numLines)
   {
-    line = inputLines[lineNumber++].trimmed();
+    const char *eol = (const char*)memchr(pos, '\n', end-pos);
+    if (eol == NULL)
+      eol = end; // the last line
+    const char *begin = pos;
+    pos = eol + 1;
+    lineNumber++;
     if ((lineNumber & 0x3FF) == 0) // update progress bar occasionally
     {
-      parent->setBarVal(lineNumber);
-      QApplication::processEvents(); // update display every so often
+      ptrReporter->setBarVal(lineNumber);
+      QCoreApplication::processEvents(); // update display every so often
     }
+    line = QString::fromUtf8(begin, eol-begin).trimmed();
+
     if (line == "")
     { } // do nothing
     // Check for options ------------------------------------------------------------
     else if (line.startsWith("#!"))
     {
       if (!parsed.wantLists.isEmpty())
-        return fatalError(parent, "Options (#!...) cannot be declared after first real want list", lineNumber);
+        return fatalError(ptrReporter, "Options (#!...) cannot be declared after first real want list", lineNumber);
       if (!parsed.officialNames.isEmpty())
-        return fatalError(parent, "Options (#!...) cannot be declared after official names", lineNumber);
+        return fatalError(ptrReporter, "Options (#!...) cannot be declared after official names", lineNumber);
 
-      // Handle options
-      QStringList options = line.toUpper().right(line.length()-2).trimmed().split(QRegExp("\\s+"));
-      for (int a=0; a<options.size(); a++)
-      {
-        QString opt = options.at(a);
-
-        if (opt == "CASE-SENSITIVE")
-          setOption("caseSensitive", true, "CASE-SENSITIVE");
-        else if (opt == "REQUIRE-COLONS")
-          setOption("requireColons", true, "REQUIRE-COLONS");
-        else if (opt == "REQUIRE-USERNAMES")
-          setOption("requireUsernames", true, "REQUIRE-USERNAMES");
-        else if (opt == "HIDE-ERRORS")
-          setOption("showErrors", false, "HIDE-ERRORS");
-        else if (opt == "HIDE-REPEATS")
-          setOption("showRepeats", false, "HIDE-REPEATS");
-        else if (opt == "HIDE-LOOPS")
-          setOption("showLoops", false, "HIDE-LOOPS");
-        else if (opt == "HIDE-SUMMARY")
-          setOption("showSummary", false, "HIDE-SUMMARY");
-        else if (opt == "HIDE-NONTRADES")
-          setOption("showNonTrades", false, "HIDE-NONTRADES");
-        else if (opt == "HIDE-STATS")
-          setOption("showStats", false, "HIDE-STATS");
-        else if (opt == "SHOW-MISSING")
-          setOption("showMissing", true, "SHOW-MISSING");
-        else if (opt == "SORT-BY-ITEM")
-          setOption("sortByItem", true, "SORT-BY-ITEM");
-        else if (opt == "ALLOW-DUMMIES")
-          setOption("allowDummies", true, "ALLOW-DUMMIES");
-        else if (opt == "SHOW-ELAPSED-TIME")
-          setOption("showElapsedTime", true, "SHOW-ELAPSED-TIME");
-        else if (opt == "LINEAR-PRIORITIES")
-          setOption("priorityScheme", true, "LINEAR-PRIORITIES", LINEAR_PRIORITIES);
-        else if (opt == "TRIANGLE-PRIORITIES")
-          setOption("priorityScheme", true, "TRIANGLE-PRIORITIES", TRIANGLE_PRIORITIES);
-        else if (opt == "SQUARE-PRIORITIES")
-          setOption("priorityScheme", true, "SQUARE-PRIORITIES", SQUARE_PRIORITIES);
-        else if (opt == "SCALED-PRIORITIES")
-          setOption("priorityScheme", true, "SCALED-PRIORITIES", SCALED_PRIORITIES);
-        else if (opt == "EXPLICIT-PRIORITIES")
-          setOption("priorityScheme", true, "EXPLICIT-PRIORITIES", EXPLICIT_PRIORITIES);
-        else if (opt.startsWith("SMALL-STEP="))
-        {
-          bool ok;
-          int val = opt.right(opt.length()-11).toInt(&ok);
-          if (!ok || val<0)
-            return fatalError(parent, "SMALL-STEP argument must be a non-negative integer",lineNumber);
-          setOption("smallStep", true, "SMALL-STEP", val);
-        }
-        else if (opt.startsWith("BIG-STEP="))
-        {
-          bool ok;
-          int val = opt.right(opt.length()-9).toInt(&ok);
-          if (!ok || val<0)
-            return fatalError(parent, "BIG-STEP argument must be a non-negative integer",lineNumber);
-          setOption("bigStep", true, "BIG-STEP", val);
-        }
-        else if (opt.startsWith("NONTRADE-COST="))
-        {
-          bool ok;
-          int val = opt.right(opt.length()-9).toInt(&ok);
-          if (!ok || val<=0)
-            return fatalError(parent, "NONTRADE-COST argument must be a positive integer",lineNumber);
-          setOption("nonTradeCost", true, "NONTRADE-COST", val);
-        }
-        else if (opt.startsWith("ITERATIONS="))
-        {
-          bool ok;
-          int val = opt.right(opt.length()-11).toInt(&ok);
-          if (!ok || val<=0)
-            return fatalError(parent, "ITERATIONS argument must be a positive integer",lineNumber);
-          setOption("iterations", true, "ITERATIONS", val);
-        }
-        else if (opt.startsWith("SEED="))
-        {
-          bool ok;
-          int val = opt.right(opt.length()-5).toInt(&ok);
-          if (!ok || val<=0)
-            return fatalError(parent, "SEED argument must be a positive integer",lineNumber);
-          setOption("randSeed", true, "SEED", val);
-        }
-        else if (opt == "VERBOSE") // (1.4)
-          setOption("verbose", true, "VERBOSE");
-        else if (opt.startsWith("METRIC=")) // (1.4)
-        {
-          QString met = opt.right(opt.length()-7);
-          if (met == "USERS-TRADING")
-            setOption("metric", true, "METRIC=USERS-TRADING", USERS_TRADING);
-          else if (met == "USERS-SOS")
-            setOption("metric", true, "METRIC=USERS-SOS", USERS_SOS);
-          else if (met == "COMBINE-SHIPPING")
-            setOption("metric", true, "METRIC=COMBINE-SHIPPING", COMBINE_SHIPPING);
-          else if (met == "CHAIN-SIZES-SOS") // default
-            setOption("metric", true, "METRIC=CHAIN-SIZES-SOS", CHAIN_SIZES_SOS);
-          else
-            return fatalError(parent, "Unknown metric option \""+met+"\"",lineNumber);
-        }
-        else
-          return fatalError(parent, "Unknown option \""+opt+"\"",lineNumber);
-      } // end for(options)
+      if (!parseOptions(ptrReporter, line, lineNumber))
+        return false;
     } // end if(option)
     else if (line.startsWith("#"))
     {
@@ -147,104 +173,52 @@ bool parseInput(MainWindow *parent, QString input, ParseDataType &parsed)
     else if (line.toUpper() == "!BEGIN-OFFICIAL-NAMES")
     {
       if (!parsed.officialNames.isEmpty())
-        return fatalError(parent, "Cannot begin official names more than once", lineNumber);
+        return fatalError(ptrReporter, "Cannot begin official names more than once", lineNumber);
       if (!parsed.wantLists.isEmpty())
-        return fatalError(parent, "Official names cannot be declared after first real want list", lineNumber);
+        return fatalError(ptrReporter, "Official names cannot be declared after first real want list", lineNumber);
 
       readingOfficialNames = true;
     }
     else if (line.toUpper() == "!END-OFFICIAL-NAMES")
     {
       if (!readingOfficialNames)
-        return fatalError(parent, "!END-OFFICIAL-NAMES without matching !BEGIN-OFFICIAL-NAMES", lineNumber);
+        return fatalError(ptrReporter, "!END-OFFICIAL-NAMES without matching !BEGIN-OFFICIAL-NAMES", lineNumber);
       readingOfficialNames = false;
     }
     else if (readingOfficialNames)
     {
       if (line.left(1) == ":")
-        return fatalError(parent, "Line cannot begin with colon",lineNumber);
+        return fatalError(ptrReporter, "Line cannot begin with colon",lineNumber);
       if (line.left(1) == "%")
-        return fatalError(parent, "Cannot give official names for dummy items",lineNumber);
+        return fatalError(ptrReporter, "Cannot give official names for dummy items",lineNumber);
 
       QString name = line.split(QRegExp("[:\\s]"))[0];
       if (!gOptions["caseSensitive"].enabled)
         name = name.toUpper();
-      if (parsed.officialNames.contains(name))
-        return fatalError(parent, "Official name "+name+"+ already defined",lineNumber);
+      if (parsed.officialSet.contains(name))
+        return fatalError(ptrReporter, "Official name "+name+"+ already defined",lineNumber);
       parsed.officialNames.append(name);
+      parsed.officialSet.insert(name);
     }
 
     // Handle wants -----------------------------------------------------------------
     else
     {
-      // Check parens for username preceding wants
-      if (line.indexOf("(") == -1 && gOptions["requireUsernames"].enabled)
-        return fatalError(parent, "Missing username with REQUIRE-USERNAMES selected",lineNumber);
-      if (line.left(1) == "(")
-      {
-        if (line.lastIndexOf("(") > 0)
-          return fatalError(parent, "Cannot have more than one '(' per line",lineNumber);
-        int close = line.indexOf(")");
-        if (close == -1)
-          return fatalError(parent, "Missing ')' in username",lineNumber);
-        if (close == line.length()-1)
-          return fatalError(parent, "Username cannot appear on a line by itself",lineNumber);
-        if (line.lastIndexOf(")") > close)
-          return fatalError(parent, "Cannot have more than one ')' per line",lineNumber);
-        if (close == 1)
-          return fatalError(parent, "Cannot have empty parentheses",lineNumber);
-
-        // Temporarily replace spaces in username with #'s
-        if (line.indexOf(" ") < close)
-          line = line.left(close+1).replace(" ","#")+" " + line.mid(close+1);
-      }
-      else if (line.contains("("))
-        return fatalError(parent, "Username (parentheses) can only be used at the front of a want list",lineNumber);
-      else if (line.contains(")"))
-        return fatalError(parent, "Bad ')' on a line that does not have a '('",lineNumber);
-
-      // Check wants for semicolons, which indicate a large step in rank
-      // value between two wants
-      line = line.replace(";"," ; "); // place extra space around semicolons
-      if (line.contains(";"))
-      {
-        int semiPos = line.indexOf(";");
-        if (semiPos < line.indexOf(":")) // Semicolons can only appear between wants
-          return fatalError(parent, "Semicolon cannot appear before colon",lineNumber);
-        QString before = line.left(semiPos).trimmed();
-        if (before.length() == 0 || before.right(1)==")")
-          return fatalError(parent, "Semicolon cannot appear before first item on line", lineNumber);
-      }
-
-      // Check and remove colon, which should occur just after the item whose
-      // wants are being specified
-      if (line.contains(":"))
-      {
-        int colonPos = line.indexOf(":");
-        if (line.lastIndexOf(":") != colonPos)
-          return fatalError(parent, "Cannot have more that one colon on a line",lineNumber);
-        QString header = line.left(colonPos).trimmed();
-        if (!header.contains(QRegExp("(.*\\)\\s+)?[^(\\s)]\\S*")))
-          return fatalError(parent, "Must have exactly one item before a colon (:)",lineNumber);
-        line = line.replace(colonPos, 1, " "); // remove colon
-      }
-      else if (gOptions["requireColons"].enabled)
-        return fatalError(parent, "Missing colon with REQUIRE-COLONS selected",lineNumber);
-
-      if (!gOptions["caseSensitive"].enabled)
-        line = line.toUpper();
-      // Add an array of each item on the list to wantLists. The first item is
-      // the username, if present. The next item (or the first, if no username)
-      // is the item whose wants are specified in the remaining items.
-      parsed.wantLists.append(line.trimmed().split(QRegExp("\\s+")));
-
+      // The want lists start here. The rest of the input can only hold want
+      // lists (besides comments and errors), so it's parsed in parallel.
+      wantsBegin = begin;
+      wantsLine = lineNumber;
+      break;
     } // end if (what to handle)
   } // end while(lines)
-  parent->setBarVal(inputLines.size());
+
+  if (wantsBegin != NULL  &&  !parseWantLists(ptrReporter, wantsBegin, end, wantsLine, parsed))
+    return false;
+  ptrReporter->setBarVal(numLines);
 
   if (parsed.wantLists.isEmpty())
   {
-    QMessageBox::critical(parent, "Input Error", "No want lists found in input; nothing to process");
+    ptrReporter->inputError("No want lists found in input; nothing to process");
     return false;
   }
 
@@ -252,117 +226,546 @@ bool parseInput(MainWindow *parent, QString input, ParseDataType &parsed)
 }
 
 
-void buildGraph(MainWindow *parent, ParseDataType &parsed, Graph &graph)
+// Builds the graph in two passes over the want lists, one for the nodes
+// and one for the edges. Each pass looks the want lists over in chunks on
+// all cores (see findItems() and findWants()), and then makes the changes
+// the chunks asked for, in order.
+void buildGraph(Reporter *ptrReporter, ParseDataType &parsed, Graph &graph)
 {
   QHash<QString,int> unknownNames;
+  QAtomicInt progress;
   parsed.numItems = 0;
   parsed.numDummyItems = 0;
   parsed.maxNameWidth = 0;
+  QList<BuildChunkType> chunks = buildChunks(parsed, graph, &progress);
 
   // Create the nodes -------------------------------------------------------------
-  parent->setBarFormat("Constructing graph", parsed.wantLists.size());
-  for (int i = 0; i < parsed.wantLists.size()  &&  *graph.ptrKeepRunning; i++)
+  ptrReporter->setBarFormat("Constructing graph", parsed.wantLists.size());
+  runChunks(ptrReporter, chunks, findItems, &progress, 0);
+  for (int idx = 0; idx < chunks.size()  &&  graph.ptrKeepRunning->loadAcquire(); idx++)
   {
-    if ((i & 0x1FF) == 0) // check once in a while
+    BuildChunkType &chunk = chunks[idx];
+    for (int i = chunk.first; i < chunk.last  &&  graph.ptrKeepRunning->loadAcquire(); i++)
     {
-      parent->setBarVal(i+1);
-      QApplication::processEvents(); // update display every so often
-    }
+      const ItemType &item = chunk.items.at(i - chunk.first);
+      if (item.ownerId != EMPTY_SYMBOL)
+      {
+        parsed.wantLists[i].removeFirst(); // remove the username from the list
+        QString owner = gSymbols.at(item.ownerId);
+        if (!parsed.usernameSet.contains(owner)) // track unique users
+        {
+          parsed.usernames.append(owner);
+          parsed.usernameSet.insert(owner);
+        }
+      }
+      if (!item.error.isEmpty())
+        parsed.errors.append(item.error);
+      else if (item.isDummy)
+        parsed.wantLists[i][0] = gSymbols.intern(item.name); // update wantlists
+      int nameId = parsed.wantLists.at(i).at(0);
+      QString name = item.name;
+
+      // Check whether the item exists in the list of official item names, if present
+      if (!parsed.officialNames.isEmpty() && !item.isOfficial && !item.isDummy)
+      {
+        parsed.errors.append("**** Cannot define want list for "+name+" because it is not an official name.  (Usually indicates a typo by the item owner.)");
+        parsed.wantLists[i] = QVector<int>();
+      }
+      else if (graph.getNode(nameId) != NULL)
+      {
+        parsed.errors.append("**** Item " + name + " has multiple want lists--ignoring all but first.  (Sometimes the result of an accidental line break in the middle of a want list.)");
+        parsed.wantLists[i] = QVector<int>();
+      }
+      else
+      {
+        parsed.numItems++; // increment the number of items being offered
+        if (item.isDummy)
+          parsed.numDummyItems++; // keep track of how many offered items are dummy items
 
-    QStringList list = parsed.wantLists.at(i);
-    Q_ASSERT(!list.isEmpty()); // Every array of strings should be a formatted want list
-    QString name = list[0]; // The item to be traded (whose wants are specified here)
-    QString owner = "";    // The user owning the item
+        // Add sender and wanter vertices (nodes) to the graph
+        Node *ptrNode = graph.addNode(nameId, item.ownerId, item.isDummy);
 
-    // Check whether a name is present as the first string
-    if (name.left(1) == "(")
-    {
-      owner = name.replace("#"," "); // restore spaces in username
-      parsed.wantLists[i].removeFirst(); // remove the username from the list
-      list = parsed.wantLists.at(i);
-      name = list[0]; // set the current item to be traded to the next string
-      if (!parsed.usernames.contains(owner)) // track unique users
-        parsed.usernames.append(owner);
+        // Mark this item's name as added to the graph
+        if (item.isOfficial)
+          parsed.usedNames.insert(name);
+
+        // Keep track of the longest name+entry length for output formatting purposes
+        if (!item.isDummy && parsed.maxNameWidth < ptrNode->show(gSettings.sortByItem).length())
+          parsed.maxNameWidth = ptrNode->show(gSettings.sortByItem).length();
+      }
     }
+    chunk.items.clear();
+    QCoreApplication::processEvents(); // update display every so often
+  }
 
-    // Check whether this item is a dummy item
-    bool isDummy = (name.left(1) == "%");
-    if (isDummy)
+
+  // Create the edges -------------------------------------------------------------
+  ptrReporter->setBarFormat("Adding connections", parsed.wantLists.size());
+  progress.store(0);
+  if (graph.ptrKeepRunning->loadAcquire())
+    runChunks(ptrReporter, chunks, wantsPass(gSettings.priorityScheme), &progress, 0);
+  for (int idx = 0; idx < chunks.size()  &&  graph.ptrKeepRunning->loadAcquire(); idx++)
+  {
+    BuildChunkType &chunk = chunks[idx];
+    int next = 0; // the chunk's next want
+    for (int i = chunk.first; i < chunk.last; i++)
     {
-      if (owner.isEmpty())
-        parsed.errors.append("**** Dummy item " + name + " declared without a username.");
-      else if (!gOptions["allowDummies"].enabled)
-        parsed.errors.append("**** Dummy items not allowed. ("+name+")");
-      else
+      const QVector<int> &list = parsed.wantLists.at(i);
+      if (list.isEmpty())
+        continue; // skip the duplicate lists
+      Node *ptrFromNode = graph.getNode(list[0]);
+
+      // Add the "no-trade" edge to itself (from wanter to sender node)
+      graph.addEdge(ptrFromNode, ptrFromNode->ptrTwin, gSettings.nonTradeCost);
+
+      // Add a connection from the listed item's receiver node to each of
+      // the wanted items' sender nodes
+      int numWants = chunk.numWants.at(i - chunk.first);
+      for (int j = 0; j < numWants; j++, next++)
+        graph.addEdge(ptrFromNode, chunk.wants.at(next).ptrSender, chunk.wants.at(next).cost);
+
+      // Update costs for those priority schemes that need information such as
+      // number of wants
+      if (gSettings.priorityScheme == SCALED_PRIORITIES  &&  !ptrFromNode->isDummy)
       {
-        name += " for user " + owner;
-        list[0] = name;
-        parsed.wantLists[i] = list; // update wantlists
+        int n = ptrFromNode->edges.size()-1;
+        for (int idx=0; idx<ptrFromNode->edges.size(); idx++)
+        {
+          Edge *e = ptrFromNode->edges.at(idx);
+          if (e->ptrSender != ptrFromNode->ptrTwin)
+            e->cost = 1 + (e->cost-1)*2520/n;
+        }
       }
     }
+    parsed.errors.append(chunk.errors);
+
+    // Total up the unknown items
+    QHash<QString,int>::const_iterator u;
+    for (u = chunk.unknownNames.constBegin(); u != chunk.unknownNames.constEnd(); ++u)
+      unknownNames[u.key()] += u.value();
+    chunk.wants.clear();
+    QCoreApplication::processEvents(); // update display every so often
+  } // end for(create edges)
+  ptrReporter->setBarVal(parsed.wantLists.size());
+
+  // "Freeze" the graph, declaring that we have finished adding things to it
+  // and readying it for cleanup and analysis
+  graph.freeze();
+
+  // If any unknown items were added as wants, display those to the user now,
+  // sorted, since the chunks may have found them in any order
+  QStringList unknownList = unknownNames.keys();
+  std::sort(unknownList.begin(), unknownList.end());
+  for (int i = 0; i < unknownList.size()  &&  graph.ptrKeepRunning->loadAcquire(); i++)
+  {
+    QString item = unknownList.at(i);
+    int occurrences = unknownNames.value(item);
+    QString plural = (occurrences == 1) ? "" : "s";
+    parsed.errors.append("**** Unknown item " + item + " (" + QString::number(occurrences)
+                          + " occurrence" + plural + ")");
+  }
 
-    // Check whether the item exists in the list of official item names, if present
-    if (!parsed.officialNames.isEmpty() && !parsed.officialNames.contains(name) && !isDummy)
+} // end buildGraph()
+
+
+
+// Local functions follow -------------------------------------------------------
+
+// Parses the rest of the input, starting with the first want list on line
+// firstLine. It's split into chunks of whole lines for parseChunk() to
+// parse on all cores. The chunks are merged in order, and the first error
+// is reported, so the result is the same as parsing one line at a time.
+static bool parseWantLists(Reporter *ptrReporter, const char *begin, const char *end,
+                           int firstLine, ParseDataType &parsed)
+{
+  QAtomicInt progress;
+  QList<ParseChunkType> chunks;
+  int chunkSize = qMax(PARSE_CHUNK_BYTES,
+                       (int)(end-begin) / (QThreadPool::globalInstance()->maxThreadCount()*CHUNKS_PER_THREAD));
+  while (begin < end)
+  {
+    ParseChunkType chunk;
+    chunk.begin = begin;
+    chunk.end = end;
+    if (end-begin > chunkSize)
     {
-      parsed.errors.append("**** Cannot define want list for "+name+" because it is not an official name.  (Usually indicates a typo by the item owner.)");
-      parsed.wantLists[i] = QStringList();
+      const char *eol = (const char*)memchr(begin+chunkSize, '\n', end-begin-chunkSize);
+      if (eol != NULL)
+        chunk.end = eol + 1;
     }
-    else if (graph.getNode(name) != NULL)
+    chunk.hasOfficialNames = !parsed.officialNames.isEmpty();
+    chunk.ptrProgress      = &progress;
+    chunk.numLines         = 0;
+    chunks.append(chunk);
+    begin = chunk.end;
+  }
+
+  runChunks(ptrReporter, chunks, parseChunk, &progress, firstLine);
+
+  // Merge the chunks, renumbering their tokens in the order they were first
+  // seen, which keeps the ids the same as well
+  int lineNumber = firstLine - 1;
+  for (int idx=0; idx<chunks.size(); idx++)
+  {
+    ParseChunkType &chunk = chunks[idx];
+    QVector<int> globalId(chunk.symbols.size());
+    for (int id=0; id<chunk.symbols.size(); id++)
+      globalId[id] = gSymbols.intern(chunk.symbols.at(id));
+    for (int i=0; i<chunk.wantLists.size(); i++)
     {
-      parsed.errors.append("**** Item " + name + " has multiple want lists--ignoring all but first.  (Sometimes the result of an accidental line break in the middle of a want list.)");
-      parsed.wantLists[i] = QStringList();
+      QVector<int> &list = chunk.wantLists[i];
+      for (int j=0; j<list.size(); j++)
+        list[j] = globalId.at(list.at(j));
+      parsed.wantLists.append(list);
     }
-    else
-    {
-      parsed.numItems++; // increment the number of items being offered
-      if (isDummy)
-        parsed.numDummyItems++; // keep track of how many offered items are dummy items
+    lineNumber += chunk.numLines;
+    if (!chunk.error.isEmpty())
+      return fatalError(ptrReporter, chunk.error, lineNumber);
+  }
+  return true;
+}
 
-      // Add sender and wanter vertices (nodes) to the graph
-      Node *ptrNode = graph.addNode(name, owner, isDummy);
 
-      // Mark this item's name as added to the graph
-      if (parsed.officialNames.contains(name))
-        parsed.usedNames.append(name);
+// Parses one chunk of the want list section, until its first error
+static void parseChunk(ParseChunkType &chunk)
+{
+  const char *pos = chunk.begin;
+  while (pos < chunk.end  &&  chunk.error.isEmpty())
+  {
+    const char *eol = (const char*)memchr(pos, '\n', chunk.end-pos);
+    if (eol == NULL)
+      eol = chunk.end; // the last line
+    const char *begin = pos;
+    pos = eol + 1;
+    if ((++chunk.numLines & 0x3FF) == 0)
+      chunk.ptrProgress->fetchAndAddRelaxed(0x400);
 
-      // Keep track of the longest name+entry length for output formatting purposes
-      if (!isDummy && parsed.maxNameWidth < ptrNode->show(gOptions["sortByItem"].enabled).length())
-        parsed.maxNameWidth = ptrNode->show(gOptions["sortByItem"].enabled).length();
+    // Nearly every line is a want list in plain ASCII
+    if (parseWantsView(begin, eol, chunk) != VIEW_FALLBACK)
+      continue;
+
+    QString line = QString::fromUtf8(begin, eol-begin).trimmed();
+    if (line == "")
+    { } // do nothing
+    else if (line.startsWith("#!"))
+      chunk.error = "Options (#!...) cannot be declared after first real want list";
+    else if (line.startsWith("#"))
+    { } // skip commented lines
+    else if (line.toUpper() == "!BEGIN-OFFICIAL-NAMES")
+    {
+      if (chunk.hasOfficialNames)
+        chunk.error = "Cannot begin official names more than once";
+      else
+        chunk.error = "Official names cannot be declared after first real want list";
     }
+    else if (line.toUpper() == "!END-OFFICIAL-NAMES")
+      chunk.error = "!END-OFFICIAL-NAMES without matching !BEGIN-OFFICIAL-NAMES";
+    else
+      parseWantsString(line, chunk);
   }
+}
 
 
-  // Create the edges -------------------------------------------------------------
-  parent->setBarFormat("Adding connections", parsed.wantLists.size());
-  for (int i = 0; i < parsed.wantLists.size()  &&  *graph.ptrKeepRunning; i++)
+// Handles a want list line straight from the input bytes. It makes the same
+// checks, in the same order, as parseWantsString(), which spaces out
+// semicolons, swaps the spaces in a username for #'s, removes the colon,
+// and splits the line. Here WantLexer scans the line once and picks out
+// the same tokens without changing it. Lines that aren't want lists in
+// plain ASCII are left
+// to parseChunk(), as are usernames with other whitespace, colons, or
+// semicolons in them, which parseWantsString() splits up in odd ways.
+static ViewResult parseWantsView(const char *begin, const char *end, ParseChunkType &chunk)
+{
+  // Trim the line. What's trimmed off is ASCII, so the rest of the line
+  // decides whether it's all ASCII.
+  while (begin < end && IS_SPACE(*begin))
+    begin++;
+  while (end > begin && IS_SPACE(end[-1]))
+    end--;
+  if (begin == end || *begin == '#' || *begin == '!')
+    return VIEW_FALLBACK; // blank, a comment, an option, or official names
+
+  // Find the characters that need checking, and fold the case, but only
+  // handle want lists in plain ASCII
+  WantLexer &lexer = chunk.lexer;
+  if (!lexer.lex(begin, end-begin, !gSettings.caseSensitive))
+    return VIEW_FALLBACK;
+  const char *text = lexer.text();
+  int len = lexer.length();
+  int firstOpen = lexer.firstOpen,   lastOpen = lexer.lastOpen;
+  int firstClose = lexer.firstClose, lastClose = lexer.lastClose;
+  int firstColon = lexer.firstColon, lastColon = lexer.lastColon;
+  int firstSemi = lexer.firstSemi,   firstSpace = lexer.firstSpace;
+
+  // Check parens for username preceding wants
+  bool hasUsername = (text[0] == '(');
+  if (firstOpen == -1 && gSettings.requireUsernames)
+    return viewError(chunk, "Missing username with REQUIRE-USERNAMES selected");
+  if (hasUsername)
+  {
+    if (lastOpen > 0)
+      return viewError(chunk, "Cannot have more than one '(' per line");
+    if (firstClose == -1)
+      return viewError(chunk, "Missing ')' in username");
+    if (firstClose == len-1)
+      return viewError(chunk, "Username cannot appear on a line by itself");
+    if (lastClose > firstClose)
+      return viewError(chunk, "Cannot have more than one ')' per line");
+    if (firstClose == 1)
+      return viewError(chunk, "Cannot have empty parentheses");
+
+    if ((firstColon != -1 && firstColon < firstClose) ||
+        (firstSemi != -1 && firstSemi < firstClose) ||
+        (lexer.firstOtherSpace != -1 && lexer.firstOtherSpace < firstClose))
+      return VIEW_FALLBACK;
+  }
+  else if (firstOpen != -1)
+    return viewError(chunk, "Username (parentheses) can only be used at the front of a want list");
+  else if (firstClose != -1)
+    return viewError(chunk, "Bad ')' on a line that does not have a '('");
+
+  // Semicolons can only appear between wants
+  if (firstSemi != -1)
+  {
+    if (firstSemi < firstColon)
+      return viewError(chunk, "Semicolon cannot appear before colon");
+    const char *before = text + firstSemi;
+    while (before > text && IS_SPACE(before[-1]))
+      before--;
+    if (before == text || before[-1] == ')')
+      return viewError(chunk, "Semicolon cannot appear before first item on line");
+  }
+
+  // Check the colon. A username always counts as an item before it, and
+  // otherwise there are no parentheses, so anything before it will do.
+  if (firstColon != -1)
+  {
+    if (lastColon != firstColon)
+      return viewError(chunk, "Cannot have more that one colon on a line");
+    if (!hasUsername && firstColon == 0)
+      return viewError(chunk, "Must have exactly one item before a colon (:)");
+  }
+  else if (gSettings.requireColons)
+    return viewError(chunk, "Missing colon with REQUIRE-COLONS selected");
+
+  // Pick out the tokens
+  QVector<int> list;
+  int pos = 0;
+  if (hasUsername && firstSpace < firstClose) // including no spaces at all
+  {
+    // The QString code puts a space after a username like this, so it
+    // ends at its ')', spaces and all
+    list.append(internToken(chunk.symbols, text, firstClose+1, true));
+    pos = firstClose + 1;
+  }
+  for (int start = lexer.nextToken(pos); start != -1; start = lexer.nextToken(pos))
+    list.append(internToken(chunk.symbols, text+start, pos-start, list.isEmpty() && hasUsername));
+  chunk.wantLists.append(list);
+  return VIEW_PARSED;
+}
+
+
+// Handles any other want list line
+static bool parseWantsString(QString line, ParseChunkType &chunk)
+{
+  // Check parens for username preceding wants
+  if (line.indexOf("(") == -1 && gSettings.requireUsernames)
+    return wantError(chunk, "Missing username with REQUIRE-USERNAMES selected");
+  if (line.left(1) == "(")
+  {
+    if (line.lastIndexOf("(") > 0)
+      return wantError(chunk, "Cannot have more than one '(' per line");
+    int close = line.indexOf(")");
+    if (close == -1)
+      return wantError(chunk, "Missing ')' in username");
+    if (close == line.length()-1)
+      return wantError(chunk, "Username cannot appear on a line by itself");
+    if (line.lastIndexOf(")") > close)
+      return wantError(chunk, "Cannot have more than one ')' per line");
+    if (close == 1)
+      return wantError(chunk, "Cannot have empty parentheses");
+
+    // Temporarily replace spaces in username with #'s
+    if (line.indexOf(" ") < close)
+      line = line.left(close+1).replace(" ","#")+" " + line.mid(close+1);
+  }
+  else if (line.contains("("))
+    return wantError(chunk, "Username (parentheses) can only be used at the front of a want list");
+  else if (line.contains(")"))
+    return wantError(chunk, "Bad ')' on a line that does not have a '('");
+
+  // Check wants for semicolons, which indicate a large step in rank
+  // value between two wants
+  line = line.replace(";"," ; "); // place extra space around semicolons
+  if (line.contains(";"))
+  {
+    int semiPos = line.indexOf(";");
+    if (semiPos < line.indexOf(":")) // Semicolons can only appear between wants
+      return wantError(chunk, "Semicolon cannot appear before colon");
+    QString before = line.left(semiPos).trimmed();
+    if (before.length() == 0 || before.right(1)==")")
+      return wantError(chunk, "Semicolon cannot appear before first item on line");
+  }
+
+  // Check and remove colon, which should occur just after the item whose
+  // wants are being specified
+  if (line.contains(":"))
   {
-    if ((i & 0x1FF) == 0) // check once in a while
+    int colonPos = line.indexOf(":");
+    if (line.lastIndexOf(":") != colonPos)
+      return wantError(chunk, "Cannot have more that one colon on a line");
+    QString header = line.left(colonPos).trimmed();
+    if (!header.contains(QRegExp("(.*\\)\\s+)?[^(\\s)]\\S*")))
+      return wantError(chunk, "Must have exactly one item before a colon (:)");
+    line = line.replace(colonPos, 1, " "); // remove colon
+  }
+  else if (gSettings.requireColons)
+    return wantError(chunk, "Missing colon with REQUIRE-COLONS selected");
+
+  if (!gSettings.caseSensitive)
+    line = line.toUpper();
+  // Add an array of each item on the list to wantLists. The first item is
+  // the username, if present. The next item (or the first, if no username)
+  // is the item whose wants are specified in the remaining items. Each
+  // is interned here, so from now on they're only handled by their ids.
+  QStringList items = line.trimmed().split(QRegExp("\\s+"));
+  QVector<int> list(items.size());
+  for (int idx=0; idx<items.size(); idx++)
+  {
+    if (idx == 0 && items.at(0).left(1) == "(")
+      items[0].replace("#"," "); // restore spaces in username
+    list[idx] = chunk.symbols.intern(items.at(idx));
+  }
+  chunk.wantLists.append(list);
+  return true;
+}
+
+
+static ViewResult viewError(ParseChunkType &chunk, QString str)
+{
+  chunk.error = str;
+  return VIEW_FAILED;
+}
+
+static bool wantError(ParseChunkType &chunk, QString str)
+{
+  chunk.error = str;
+  return false;
+}
+
+
+// Interns a token picked out by parseWantsView(), already in upper case
+// unless CASE-SENSITIVE
+static int internToken(SymbolTable &symbols, const char *str, int len, bool isUsername)
+{
+  QString token = QString::fromLatin1(str, len);
+  if (isUsername)
+    token.replace('#', ' '); // restore spaces in username
+  return symbols.intern(token);
+}
+
+
+// Splits the want lists into chunks for the passes of buildGraph()
+static QList<BuildChunkType> buildChunks(ParseDataType &parsed, Graph &graph, QAtomicInt *ptrProgress)
+{
+  QList<BuildChunkType> chunks;
+  int numLists = parsed.wantLists.size();
+  int chunkSize = qMax(BUILD_CHUNK_LISTS, numLists / (QThreadPool::globalInstance()->maxThreadCount()*CHUNKS_PER_THREAD));
+  for (int first = 0; first < numLists; first += chunkSize)
+  {
+    BuildChunkType chunk;
+    chunk.first = first;
+    chunk.last = qMin(first + chunkSize, numLists);
+    chunk.ptrParsed = &parsed;
+    chunk.ptrGraph = &graph;
+    chunk.ptrProgress = ptrProgress;
+    chunks.append(chunk);
+  }
+  return chunks;
+}
+
+
+// The node pass. Finds the owner and name of the item of each want list in
+// the chunk, and checks its dummy item rules. Only reads gSymbols, so the
+// name of a dummy item is left for buildGraph() to intern.
+static void findItems(BuildChunkType &chunk)
+{
+  const ParseDataType &parsed = *chunk.ptrParsed;
+  chunk.items.resize(chunk.last - chunk.first);
+  for (int i = chunk.first; i < chunk.last  &&  chunk.ptrGraph->ptrKeepRunning->loadAcquire(); i++)
+  {
+    const QVector<int> &list = parsed.wantLists.at(i);
+    Q_ASSERT(!list.isEmpty()); // Every array of ids should be a formatted want list
+    ItemType &item = chunk.items[i - chunk.first];
+    item.ownerId = EMPTY_SYMBOL; // The user owning the item
+    item.name = gSymbols.at(list[0]); // The item to be traded (whose wants are specified here)
+
+    // Check whether a name is present as the first string
+    if (item.name.left(1) == "(")
+    {
+      item.ownerId = list[0];
+      item.name = gSymbols.at(list[1]); // set the current item to be traded to the next string
+    }
+
+    // Check whether this item is a dummy item
+    item.isDummy = (item.name.left(1) == "%");
+    if (item.isDummy)
     {
-      parent->setBarVal(i+1);
-      QApplication::processEvents(); // update display every so often
+      if (item.ownerId == EMPTY_SYMBOL)
+        item.error = "**** Dummy item " + item.name + " declared without a username.";
+      else if (!gSettings.allowDummies)
+        item.error = "**** Dummy items not allowed. ("+item.name+")";
+      else
+        item.name += " for user " + gSymbols.at(item.ownerId);
     }
+    item.isOfficial = parsed.officialSet.contains(item.name);
+    if (((i - chunk.first) & 0xFF) == 0xFF)
+      chunk.ptrProgress->fetchAndAddRelaxed(0x100);
+  }
+}
+
 
-    QStringList list = parsed.wantLists.at(i);
+// The edge pass. Works out the wants of each want list in the chunk, but
+// leaves adding the edges to buildGraph(), since the graph can only be
+// read here. There's one for each priority scheme (see wantsPass()).
+template <PRIORITY_TYPE SCHEME>
+static void findWants(BuildChunkType &chunk)
+{
+  const ParseDataType &parsed = *chunk.ptrParsed;
+  Graph &graph = *chunk.ptrGraph;
+  WantMarksType &marks = gWantMarks.localData();
+  if (marks.stamps.size() < graph.nameMap.size())
+    marks.stamps.resize(graph.nameMap.size()); // new names start unmarked
+  chunk.numWants.fill(0, chunk.last - chunk.first);
+  for (int i = chunk.first; i < chunk.last  &&  graph.ptrKeepRunning->loadAcquire(); i++)
+  {
+    if (((i - chunk.first) & 0xFF) == 0xFF)
+      chunk.ptrProgress->fetchAndAddRelaxed(0x100);
+    const QVector<int> &list = parsed.wantLists.at(i);
     if (list.isEmpty())
       continue; // skip the duplicate lists
 
-    QString fromName = list[0];
-    Node *ptrFromNode = graph.getNode(fromName);
-
-    // Add the "no-trade" edge to itself (from wanter to sender node)
-    graph.addEdge(ptrFromNode, ptrFromNode->ptrTwin, gOptions["nonTradeCost"].value);
+    QString fromName = gSymbols.at(list[0]);
+    Node *ptrFromNode = graph.getNode(list[0]);
+    int firstWant = chunk.wants.size(); // this list's wants start here
+    if (++marks.generation == 0) // wrapped around, so start over
+    {
+      marks.stamps.fill(0);
+      marks.generation = 1;
+    }
 
     // Evaluate each want for this item
     quint64 rank = 1;
     for (int i = 1; i < list.size(); i++)
     {
-      QString toName = list[i]; // focus on this want
+      int toId = list[i];
+      QString toName = gSymbols.at(toId); // focus on this want
 
       // A single semicolon represents a large step in rank value between
       // two items
       if (toName == ";")
       {
-        rank += gOptions["bigStep"].value;
+        rank += gSettings.bigStep;
         continue;
       }
 
@@ -370,14 +773,14 @@ void buildGraph(MainWindow *parent, ParseDataType &parsed, Graph &graph)
       if (toName.indexOf('=') >= 0)
       {
         // Handle explicit priorities (e.g., ThisWant=100)
-        if (gOptions["priorityScheme"].value != EXPLICIT_PRIORITIES)
+        if (SCHEME != EXPLICIT_PRIORITIES)
         {
-          parsed.errors.append("**** Cannot use '=' annotation in item "+toName+" in want list for item "+fromName+" unless using EXPLICIT_PRIORITIES.");
+          chunk.errors.append("**** Cannot use '=' annotation in item "+toName+" in want list for item "+fromName+" unless using EXPLICIT_PRIORITIES.");
           continue;
         }
         if (!toName.contains(QRegExp("[^=]+=[0-9]+")))
         {
-          parsed.errors.append("**** Item "+toName+" in want list for item "+fromName+" must have the format 'name=number'.");
+          chunk.errors.append("**** Item "+toName+" in want list for item "+fromName+" must have the format 'name=number'.");
           continue;
         }
         QStringList parts = toName.split("=");
@@ -385,41 +788,42 @@ void buildGraph(MainWindow *parent, ParseDataType &parsed, Graph &graph)
         quint64 explicitCost = parts[1].toLong();
         if (explicitCost < 1)
         {
-          parsed.errors.append("**** Explicit priority must be positive in item "+toName+" in want list for item "+fromName+".");
+          chunk.errors.append("**** Explicit priority must be positive in item "+toName+" in want list for item "+fromName+".");
           continue;
         }
         rank = explicitCost;
         toName = parts[0];
+        toId = gSymbols.find(toName);
       }
 
       // Handle dummy items
       if (toName.left(1) == "%")
       {
         // Make sure this item has an associated username if it wants a dummy item
-        if (ptrFromNode->owner.isEmpty())
+        if (ptrFromNode->ownerId == EMPTY_SYMBOL)
         {
-          parsed.errors.append("**** Dummy item " + toName + " used in want list for item " + fromName + ", which does not have a username.");
+          chunk.errors.append("**** Dummy item " + toName + " used in want list for item " + fromName + ", which does not have a username.");
           continue;
         }
 
         // Append the username to the dummy item to prevent confusion in cases
         // where multiple users have dummy items with the same name.
-        toName += " for user " + ptrFromNode->owner;
+        toName += " for user " + gSymbols.at(ptrFromNode->ownerId);
+        toId = gSymbols.find(toName);
       }
 
-      Node *ptrToNode = graph.getNode(toName); // grab the node for this want
+      Node *ptrToNode = graph.getNode(toId); // grab the node for this want
       if (ptrToNode == NULL)
       {
-        if (parsed.officialNames.contains(toName))
+        if (parsed.officialSet.contains(toName))
         {
           // this is an official item whose owner did not submit a want list
-          rank += gOptions["smallStep"].value;
+          rank += gSettings.smallStep;
         }
         else
         {
           // there is no offical item list; track number of uknown items
-          int occurrences = unknownNames.contains(toName) ? unknownNames.value(toName) : 0;
-          unknownNames.insert(toName, occurrences + 1);
+          chunk.unknownNames[toName]++;
         }
         continue;
       }
@@ -427,87 +831,93 @@ void buildGraph(MainWindow *parent, ParseDataType &parsed, Graph &graph)
       ptrToNode = ptrToNode->ptrTwin; // adjust to the sending node
       if (ptrToNode == ptrFromNode->ptrTwin)
       {
-        parsed.errors.append("**** Item " + toName + " appears in its own want list.");
+        chunk.errors.append("**** Item " + toName + " appears in its own want list.");
       }
-      else if (ptrFromNode->containsEdge(ptrToNode))
+      else if (marks.stamps.at(toId) == marks.generation) // already wanted
       {
-        if (gOptions["showRepeats"].enabled)
-          parsed.errors.append("**** Item " + toName + " is repeated in want list for " + fromName + ".");
+        if (gSettings.showRepeats)
+          chunk.errors.append("**** Item " + toName + " is repeated in want list for " + fromName + ".");
       }
       else if (!ptrToNode->isDummy &&
-               ptrFromNode->owner == ptrToNode->owner)
+               ptrFromNode->ownerId == ptrToNode->ownerId)
       {
-        parsed.errors.append("**** Item "+ptrFromNode->name +" contains item "+ptrToNode->name+" from the same user ("+ptrFromNode->owner+")");
+        chunk.errors.append("**** Item "+gSymbols.at(ptrFromNode->nameId) +" contains item "+gSymbols.at(ptrToNode->nameId)+" sender from the same user ("+gSymbols.at(ptrFromNode->ownerId)+")");
       }
       else
       {
-        quint64 cost = 1;
-        switch (gOptions["priorityScheme"].value)
-        {
-          case NO_PRIORITIES:       cost = 1;               break;
-          case LINEAR_PRIORITIES:   cost = rank;            break;
-          case TRIANGLE_PRIORITIES: cost = rank*(rank+1)/2; break;
-          case SQUARE_PRIORITIES:   cost = rank*rank;       break;
-          case SCALED_PRIORITIES:   cost = rank;            break; // assign later
-          case EXPLICIT_PRIORITIES: cost = rank;            break;
-          default: Q_ASSERT(false); // invalid value
-        }
+        quint64 cost = rankCost<SCHEME>(rank);
 
         // All edges out of a dummy node have the same cost because
         // they are usually considered to be the same item for
         // duplicate protection purposes.
         if (ptrFromNode->isDummy)
-          cost = gOptions["nonTradeCost"].value;
+          cost = gSettings.nonTradeCost;
 
-        // Add a connection from the listed item's receiver node to
-        // the wanted item's sender node.
-        graph.addEdge(ptrFromNode, ptrToNode, cost);
+        marks.stamps[toId] = marks.generation; // any more are repeats
+        WantType want;
+        want.ptrSender = ptrToNode;
+        want.cost = cost;
+        chunk.wants.append(want);
 
         // Increase the rank for calculating the priority of the next want
-        rank += gOptions["smallStep"].value;
+        rank += gSettings.smallStep;
       }
     }
+    chunk.numWants[i - chunk.first] = chunk.wants.size() - firstWant;
+  }
+}
 
-    // Update costs for those priority schemes that need information such as
-    // number of wants
-    if (!ptrFromNode->isDummy)
-    {
-      switch (gOptions["priorityScheme"].value)
-      {
-        case SCALED_PRIORITIES:
-          int n = ptrFromNode->edges.size()-1;
-          for (int idx=0; idx<ptrFromNode->edges.size(); idx++)
-          {
-            Edge *e = ptrFromNode->edges.at(idx);
-            if (e->ptrSender != ptrFromNode->ptrTwin)
-              e->cost = 1 + (e->cost-1)*2520/n;
-          }
-          break;
-      } // end switch
-    } // end if(isDummy)
-  } // end for(create edges)
-  parent->setBarVal(parsed.wantLists.size());
-
-  // "Freeze" the graph, declaring that we have finished adding things to it
-  // and readying it for cleanup and analysis
-  graph.freeze();
 
-  // If any unknown items were added as wants, display those to the user now
-  QHash<QString,int>::iterator i;
-  for (i = unknownNames.begin(); i != unknownNames.end()  &&  *graph.ptrKeepRunning; ++i)
+// Picks the edge pass for a priority scheme
+static BuildPassType wantsPass(PRIORITY_TYPE scheme)
+{
+  switch (scheme)
   {
-    QString item = i.key();
-    int occurrences = i.value();
-    QString plural = (occurrences == 1) ? "" : "s";
-    parsed.errors.append("**** Unknown item " + item + " (" + QString::number(occurrences)
-                          + " occurrence" + plural + ")");
+    case NO_PRIORITIES:       return findWants<NO_PRIORITIES>;
+    case LINEAR_PRIORITIES:   return findWants<LINEAR_PRIORITIES>;
+    case TRIANGLE_PRIORITIES: return findWants<TRIANGLE_PRIORITIES>;
+    case SQUARE_PRIORITIES:   return findWants<SQUARE_PRIORITIES>;
+    case SCALED_PRIORITIES:   return findWants<SCALED_PRIORITIES>;
+    case EXPLICIT_PRIORITIES: return findWants<EXPLICIT_PRIORITIES>;
   }
+  Q_ASSERT(false); // invalid value
+  return findWants<NO_PRIORITIES>;
+}
 
-} // end buildGraph()
 
+// The cost of a want of the given rank. SCHEME is a constant, so the
+// switch is resolved when findWants() is compiled for it.
+template <PRIORITY_TYPE SCHEME>
+static inline quint64 rankCost(quint64 rank)
+{
+  switch (SCHEME)
+  {
+    case NO_PRIORITIES:       return 1;
+    case LINEAR_PRIORITIES:   return rank;
+    case TRIANGLE_PRIORITIES: return rank*(rank+1)/2;
+    case SQUARE_PRIORITIES:   return rank*rank;
+    case SCALED_PRIORITIES:   return rank; // assign later
+    case EXPLICIT_PRIORITIES: return rank;
+  }
+  return 1;
+}
 
 
-// Local functions follow -------------------------------------------------------
+// Runs function on each of the chunks, on all cores. Meanwhile the GUI
+// thread moves the progress bar along and keeps the display alive.
+template <class ChunkType>
+static void runChunks(Reporter *ptrReporter, QList<ChunkType> &chunks, void (*function)(ChunkType&),
+                      QAtomicInt *ptrProgress, int base)
+{
+  QFuture<void> future = QtConcurrent::map(chunks, function);
+  while (!future.isFinished())
+  {
+    ptrReporter->setBarVal(base + ptrProgress->load());
+    QCoreApplication::processEvents(); // update display every so often
+    QThread::msleep(10);
+  }
+}
+
 
 static void setDefaultOptions( QHash<QString, OptionType> &options )
 {
@@ -525,6 +935,11 @@ static void setDefaultOptions( QHash<QString, OptionType> &options )
   options["allowDummies"]     = nope;
   options["showElapsedTime"]  = nope;
   options["verbose"]          = nope; // (1.4)
+  options["benchmarkHeaps"]   = nope;
+  options["lazyDijkstra"]     = nope;
+  options["multiAugment"]     = nope;
+  options["splitComponents"]  = nope;
+  options["profile"]          = nope;
   // These default to true:
   options["showErrors"]       = yup;
   options["showRepeats"]      = yup;
@@ -540,6 +955,7 @@ static void setDefaultOptions( QHash<QString, OptionType> &options )
   val.value = 1000000000UL;   options["nonTradeCost"]   = val;
   val.value = 1;              options["iterations"]     = val;
   val.value = 0;              options["randSeed"]       = val;
+  val.value = PAIRING_HEAP;   options["heapType"]       = val;
 }
 
 static void setOption(QString optName, bool enabled, QString name, int val)
@@ -548,11 +964,165 @@ static void setOption(QString optName, bool enabled, QString name, int val)
   gOptions[optName].value = val;
   gOptions[optName].changed = true;
   gOptions[optName].altName = name;
+  resolveOptions();
+}
+
+// Handles a line of options (#!...)
+static bool parseOptions(Reporter *ptrReporter, QString line, int lineNumber)
+{
+  QStringList options = line.toUpper().right(line.length()-2).trimmed().split(QRegExp("\\s+"));
+  for (int a=0; a<options.size(); a++)
+  {
+    QString opt = options.at(a);
+
+    if (opt == "CASE-SENSITIVE")
+      setOption("caseSensitive", true, "CASE-SENSITIVE");
+    else if (opt == "REQUIRE-COLONS")
+      setOption("requireColons", true, "REQUIRE-COLONS");
+    else if (opt == "REQUIRE-USERNAMES")
+      setOption("requireUsernames", true, "REQUIRE-USERNAMES");
+    else if (opt == "HIDE-ERRORS")
+      setOption("showErrors", false, "HIDE-ERRORS");
+    else if (opt == "HIDE-REPEATS")
+      setOption("showRepeats", false, "HIDE-REPEATS");
+    else if (opt == "HIDE-LOOPS")
+      setOption("showLoops", false, "HIDE-LOOPS");
+    else if (opt == "HIDE-SUMMARY")
+      setOption("showSummary", false, "HIDE-SUMMARY");
+    else if (opt == "HIDE-NONTRADES")
+      setOption("showNonTrades", false, "HIDE-NONTRADES");
+    else if (opt == "HIDE-STATS")
+      setOption("showStats", false, "HIDE-STATS");
+    else if (opt == "SHOW-MISSING")
+      setOption("showMissing", true, "SHOW-MISSING");
+    else if (opt == "SORT-BY-ITEM")
+      setOption("sortByItem", true, "SORT-BY-ITEM");
+    else if (opt == "ALLOW-DUMMIES")
+      setOption("allowDummies", true, "ALLOW-DUMMIES");
+    else if (opt == "SHOW-ELAPSED-TIME")
+      setOption("showElapsedTime", true, "SHOW-ELAPSED-TIME");
+    else if (opt == "LINEAR-PRIORITIES")
+      setOption("priorityScheme", true, "LINEAR-PRIORITIES", LINEAR_PRIORITIES);
+    else if (opt == "TRIANGLE-PRIORITIES")
+      setOption("priorityScheme", true, "TRIANGLE-PRIORITIES", TRIANGLE_PRIORITIES);
+    else if (opt == "SQUARE-PRIORITIES")
+      setOption("priorityScheme", true, "SQUARE-PRIORITIES", SQUARE_PRIORITIES);
+    else if (opt == "SCALED-PRIORITIES")
+      setOption("priorityScheme", true, "SCALED-PRIORITIES", SCALED_PRIORITIES);
+    else if (opt == "EXPLICIT-PRIORITIES")
+      setOption("priorityScheme", true, "EXPLICIT-PRIORITIES", EXPLICIT_PRIORITIES);
+    else if (opt.startsWith("SMALL-STEP="))
+    {
+      bool ok;
+      int val = opt.right(opt.length()-11).toInt(&ok);
+      if (!ok || val<0)
+        return fatalError(ptrReporter, "SMALL-STEP argument must be a non-negative integer",lineNumber);
+      setOption("smallStep", true, "SMALL-STEP", val);
+    }
+    else if (opt.startsWith("BIG-STEP="))
+    {
+      bool ok;
+      int val = opt.right(opt.length()-9).toInt(&ok);
+      if (!ok || val<0)
+        return fatalError(ptrReporter, "BIG-STEP argument must be a non-negative integer",lineNumber);
+      setOption("bigStep", true, "BIG-STEP", val);
+    }
+    else if (opt.startsWith("NONTRADE-COST="))
+    {
+      bool ok;
+      int val = opt.right(opt.length()-9).toInt(&ok);
+      if (!ok || val<=0)
+        return fatalError(ptrReporter, "NONTRADE-COST argument must be a positive integer",lineNumber);
+      setOption("nonTradeCost", true, "NONTRADE-COST", val);
+    }
+    else if (opt.startsWith("ITERATIONS="))
+    {
+      bool ok;
+      int val = opt.right(opt.length()-11).toInt(&ok);
+      if (!ok || val<=0)
+        return fatalError(ptrReporter, "ITERATIONS argument must be a positive integer",lineNumber);
+      setOption("iterations", true, "ITERATIONS", val);
+    }
+    else if (opt.startsWith("SEED="))
+    {
+      bool ok;
+      int val = opt.right(opt.length()-5).toInt(&ok);
+      if (!ok || val<=0)
+        return fatalError(ptrReporter, "SEED argument must be a positive integer",lineNumber);
+      setOption("randSeed", true, "SEED", val);
+    }
+    else if (opt == "VERBOSE") // (1.4)
+      setOption("verbose", true, "VERBOSE");
+    else if (opt.startsWith("METRIC=")) // (1.4)
+    {
+      QString met = opt.right(opt.length()-7);
+      if (met == "USERS-TRADING")
+        setOption("metric", true, "METRIC=USERS-TRADING", USERS_TRADING);
+      else if (met == "USERS-SOS")
+        setOption("metric", true, "METRIC=USERS-SOS", USERS_SOS);
+      else if (met == "COMBINE-SHIPPING")
+        setOption("metric", true, "METRIC=COMBINE-SHIPPING", COMBINE_SHIPPING);
+      else if (met == "CHAIN-SIZES-SOS") // default
+        setOption("metric", true, "METRIC=CHAIN-SIZES-SOS", CHAIN_SIZES_SOS);
+      else
+        return fatalError(ptrReporter, "Unknown metric option \""+met+"\"",lineNumber);
+    }
+    else if (opt.startsWith("HEAP="))
+    {
+      QString heap = opt.right(opt.length()-5);
+      if (heap == "PAIRING") // default
+        setOption("heapType", true, "HEAP=PAIRING", PAIRING_HEAP);
+      else if (heap == "QUAD")
+        setOption("heapType", true, "HEAP=QUAD", QUAD_HEAP);
+      else if (heap == "RADIX")
+        setOption("heapType", true, "HEAP=RADIX", RADIX_HEAP);
+      else if (heap == "BUCKET")
+        setOption("heapType", true, "HEAP=BUCKET", BUCKET_HEAP);
+      else if (heap == "AUTO")
+        setOption("heapType", true, "HEAP=AUTO", AUTO_HEAP);
+      else
+        return fatalError(ptrReporter, "Unknown heap option \""+heap+"\"",lineNumber);
+    }
+    else if (opt == "LAZY-DIJKSTRA")
+      setOption("lazyDijkstra", true, "LAZY-DIJKSTRA");
+    else if (opt == "MULTI-AUGMENT")
+      setOption("multiAugment", true, "MULTI-AUGMENT");
+    else if (opt == "SPLIT-COMPONENTS")
+      setOption("splitComponents", true, "SPLIT-COMPONENTS");
+    else if (opt == "BENCHMARK-HEAPS")
+      setOption("benchmarkHeaps", true, "BENCHMARK-HEAPS");
+    else if (opt == "PROFILE")
+      setOption("profile", true, "PROFILE");
+    else
+      return fatalError(ptrReporter, "Unknown option \""+opt+"\"",lineNumber);
+  } // end for(options)
+  return true;
+}
+
+
+// Copies the options used most into gSettings, whenever they change
+static void resolveOptions()
+{
+  gSettings.caseSensitive    = gOptions["caseSensitive"].enabled;
+  gSettings.requireUsernames = gOptions["requireUsernames"].enabled;
+  gSettings.requireColons    = gOptions["requireColons"].enabled;
+  gSettings.allowDummies     = gOptions["allowDummies"].enabled;
+  gSettings.showRepeats      = gOptions["showRepeats"].enabled;
+  gSettings.sortByItem       = gOptions["sortByItem"].enabled;
+  gSettings.debug            = gOptions["debug"].enabled;
+  gSettings.priorityScheme   = (PRIORITY_TYPE)gOptions["priorityScheme"].value;
+  gSettings.metric           = (METRIC_TYPE)gOptions["metric"].value;
+  gSettings.smallStep        = gOptions["smallStep"].value;
+  gSettings.bigStep          = gOptions["bigStep"].value;
+  gSettings.nonTradeCost     = gOptions["nonTradeCost"].value;
+  gSettings.iterations       = gOptions["iterations"].value;
 }
 
-static bool fatalError(QWidget *parent, QString str, int line)
+static bool fatalError(Reporter *ptrReporter, QString str, int line)
 {
-  QMessageBox::critical(parent, "Input Error", str+" (line "+QString::number(line)+")");
+  if (line > 0)
+    str += " (line "+QString::number(line)+")";
+  ptrReporter->inputError(str); // line 0 is extraOptions
 
   return false;
 }
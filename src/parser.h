@@ -1,6 +1,8 @@
 #include <QString>
+#include <QByteArray>
+#include <QSet>
 #include "graph.h"
-#include "MainWindow.h"
+#include "reporter.h"
 
 #ifndef PARSER_H
 #define PARSER_H
@@ -9,18 +11,21 @@
 
 typedef struct
 {
-  QStringList officialNames, usedNames;
+  QStringList officialNames;    // in the order they were given...
+  QSet<QString> officialSet;    // ...and hashed, for lookups
+  QSet<QString> usedNames;      // official names that have want lists
   QStringList errors;
-  QStringList usernames;
-  QList<QStringList> wantLists;
+  QStringList usernames;        // in the order they were first seen...
+  QSet<QString> usernameSet;    // ...and hashed, for lookups
+  QList< QVector<int> > wantLists; // want lists as gSymbols ids
 
   int numItems, numDummyItems;
   int maxNameWidth;
 } ParseDataType;
 
-class MainWindow;
-bool parseInput(MainWindow *parent, QString input, ParseDataType &parsed);
-void buildGraph(MainWindow *parent, ParseDataType &parsed, Graph &graph);
+bool parseInput(Reporter *ptrReporter, const QByteArray &input, ParseDataType &parsed,
+                QString extraOptions=QString());
+void buildGraph(Reporter *ptrReporter, ParseDataType &parsed, Graph &graph);
 
 //////////// OPTIONS
 
@@ -52,5 +57,25 @@ typedef enum
   // FAVOR_USER isn't implemented
 } METRIC_TYPE;
 
+// The options that are used over and over, as plain values. They're copied
+// from gOptions whenever parseInput() sets them, so the hot paths don't
+// have to look them up by name.
+typedef struct
+{
+  bool caseSensitive;
+  bool requireUsernames;
+  bool requireColons;
+  bool allowDummies;
+  bool showRepeats;
+  bool sortByItem;
+  bool debug;
+  PRIORITY_TYPE priorityScheme;
+  METRIC_TYPE metric;
+  quint64 smallStep;
+  quint64 bigStep;
+  quint64 nonTradeCost;
+  unsigned int iterations;
+} SettingsType;
+
 #endif // PARSER_H
 
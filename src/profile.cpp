@@ -0,0 +1,143 @@
+#include "profile.h"
+#include <QStringList>
+
+#if defined(Q_OS_WIN)
+#include <windows.h> // for GetProcessTimes() and GetThreadTimes()
+#elif defined(Q_OS_UNIX)
+#include <time.h>    // for clock_gettime()
+#endif
+
+static const char *phaseNames[NUM_PHASES] =
+{
+  "parse", "buildGraph", "removeImpossibleEdges", "copy", "shuffle",
+  "findCycles", "metric", "output"
+};
+
+// CPU time used so far by the process or by the calling thread, or -1
+static qint64 cpuNsecs(bool allThreads)
+{
+#if defined(Q_OS_WIN)
+  FILETIME created, exited, kernel, user;
+  BOOL ok = allThreads ? GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)
+                       : GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user);
+  if (!ok)
+    return -1;
+  quint64 ticks = ((quint64)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) +
+                  ((quint64)user.dwHighDateTime << 32 | user.dwLowDateTime);
+  return ticks * 100; // in 100 ns ticks
+#elif defined(Q_OS_UNIX)
+  struct timespec now;
+  if (clock_gettime(allThreads ? CLOCK_PROCESS_CPUTIME_ID : CLOCK_THREAD_CPUTIME_ID, &now) != 0)
+    return -1;
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+#else
+  Q_UNUSED(allThreads);
+  return -1;
+#endif
+}
+
+
+SolverCounters::SolverCounters()
+{
+  rounds       = 0;
+  inserts      = 0;
+  extracts     = 0;
+  decreaseKeys = 0;
+  relaxations  = 0;
+  settled      = 0;
+}
+
+void SolverCounters::add(const SolverCounters &other)
+{
+  rounds       += other.rounds;
+  inserts      += other.inserts;
+  extracts     += other.extracts;
+  decreaseKeys += other.decreaseKeys;
+  relaxations  += other.relaxations;
+  settled      += other.settled;
+}
+
+
+Profile::Profile()
+{
+  for (int phase=0; phase<NUM_PHASES; phase++)
+  {
+    wallNsecs[phase] = 0;
+    cpuNsecs[phase] = 0;
+    calls[phase] = 0;
+  }
+}
+
+void Profile::add(const Profile &other)
+{
+  for (int phase=0; phase<NUM_PHASES; phase++)
+  {
+    wallNsecs[phase] += other.wallNsecs[phase];
+    if (cpuNsecs[phase] < 0 || other.cpuNsecs[phase] < 0)
+      cpuNsecs[phase] = -1;
+    else
+      cpuNsecs[phase] += other.cpuNsecs[phase];
+    calls[phase] += other.calls[phase];
+  }
+  counters.add(other.counters);
+}
+
+QString Profile::text() const
+{
+  QString str = QString("%1 %2 %3 %4\n").arg("Phase", -22).arg("calls", 8)
+                .arg("wall ms", 12).arg("cpu ms", 12);
+  for (int phase=0; phase<NUM_PHASES; phase++)
+    str += QString("%1 %2 %3 %4\n").arg(phaseNames[phase], -22).arg(calls[phase], 8)
+           .arg(wallNsecs[phase] / 1e6, 12, 'f', 1)
+           .arg(cpuNsecs[phase] < 0 ? QString("-") : QString::number(cpuNsecs[phase] / 1e6, 'f', 1), 12);
+  str += "\n";
+  str += "Rounds             = " + QString::number(counters.rounds) + "\n";
+  str += "Heap inserts       = " + QString::number(counters.inserts) + "\n";
+  str += "Heap extracts      = " + QString::number(counters.extracts) + "\n";
+  str += "Heap decrease-keys = " + QString::number(counters.decreaseKeys) + "\n";
+  str += "Edge relaxations   = " + QString::number(counters.relaxations) + "\n";
+  str += "Nodes settled      = " + QString::number(counters.settled);
+  if (counters.rounds > 0)
+    str += " (avg " + QString::number((double)counters.settled / counters.rounds, 'f', 1)
+           + " per round)";
+  str += "\n";
+  return str;
+}
+
+QString Profile::json() const
+{
+  QStringList phases;
+  for (int phase=0; phase<NUM_PHASES; phase++)
+    phases.append(QString("{\"phase\": \"%1\", \"calls\": %2, \"wall_ms\": %3, \"cpu_ms\": %4}")
+                  .arg(phaseNames[phase]).arg(calls[phase])
+                  .arg(wallNsecs[phase] / 1e6, 0, 'f', 3)
+                  .arg(cpuNsecs[phase] < 0 ? QString("null")
+                                           : QString::number(cpuNsecs[phase] / 1e6, 'f', 3)));
+  return QString("{\n  \"phases\": [\n    %1\n  ],\n  \"counters\": {\"rounds\": %2, "
+                 "\"heap_inserts\": %3, \"heap_extracts\": %4, \"heap_decrease_keys\": %5, "
+                 "\"edge_relaxations\": %6, \"nodes_settled\": %7}\n}\n")
+         .arg(phases.join(",\n    ")).arg(counters.rounds).arg(counters.inserts)
+         .arg(counters.extracts).arg(counters.decreaseKeys).arg(counters.relaxations)
+         .arg(counters.settled);
+}
+
+
+PhaseTimer::PhaseTimer(Profile *ptrProfile, PHASE_TYPE phase, bool allThreads)
+{
+  this->ptrProfile = ptrProfile;
+  this->phase = phase;
+  this->allThreads = allThreads;
+  cpuStart = cpuNsecs(allThreads);
+  wall.start();
+}
+
+PhaseTimer::~PhaseTimer()
+{
+  ptrProfile->wallNsecs[phase] += wall.nsecsElapsed();
+  qint64 cpuEnd = cpuNsecs(allThreads);
+  if (cpuStart < 0 || cpuEnd < 0 || ptrProfile->cpuNsecs[phase] < 0)
+    ptrProfile->cpuNsecs[phase] = -1;
+  else
+    ptrProfile->cpuNsecs[phase] += cpuEnd - cpuStart;
+  ptrProfile->calls[phase]++;
+}
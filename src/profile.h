@@ -0,0 +1,87 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <QString>
+#include <QElapsedTimer>
+
+// The solver is only instrumented when built with CONFIG+=profile, which
+// defines TRADE_PROFILE. Otherwise the PROFILE_ macros below expand to
+// nothing, so production builds pay nothing for the counters or timers.
+#ifdef TRADE_PROFILE
+#define PROFILE_COUNT(counter, n)          ((counter) += (n))
+#define PROFILE_ADD(sum, part)             ((sum).add(part))
+#define PROFILE_PHASE(ptrProfile, phase, allThreads) \
+                                           PhaseTimer phaseTimer(ptrProfile, phase, allThreads)
+#else
+#define PROFILE_COUNT(counter, n)
+#define PROFILE_ADD(sum, part)
+#define PROFILE_PHASE(ptrProfile, phase, allThreads)
+#endif
+
+typedef enum
+{
+  PARSE_PHASE       = 0, // parseInput()
+  BUILD_PHASE       = 1, // buildGraph()
+  CULL_PHASE        = 2, // Graph::removeImpossibleEdges()
+  COPY_PHASE        = 3, // Graph::copy(), in the producer
+  SHUFFLE_PHASE     = 4, // Graph::shuffle(), in the producer
+  FIND_CYCLES_PHASE = 5, // Graph::findCycles(), in the workers
+  METRIC_PHASE      = 6, // scoring and describing results, in the workers
+  OUTPUT_PHASE      = 7, // writing up the best result
+  NUM_PHASES        = 8,
+} PHASE_TYPE;
+
+
+// What the matching rounds did. Each graph counts its own, so the workers
+// don't share them, and they're added up once a graph is solved.
+class SolverCounters
+{
+  public:
+    SolverCounters();
+    void add(const SolverCounters &other);
+
+    quint64 rounds;       // Dijkstra searches
+    quint64 inserts;      // heap operations...
+    quint64 extracts;
+    quint64 decreaseKeys;
+    quint64 relaxations;  // arcs examined from settled nodes
+    quint64 settled;      // nodes settled before each search ended
+};
+
+
+// Time spent in each phase, added up over all the threads that ran it, and
+// the solver counters of every iteration
+class Profile
+{
+  public:
+    Profile();
+    void add(const Profile &other);
+    QString text() const; // a table, for the PROFILE option
+    QString json() const;
+
+    qint64 wallNsecs[NUM_PHASES];
+    qint64 cpuNsecs[NUM_PHASES]; // -1 if the platform can't tell
+    unsigned int calls[NUM_PHASES];
+    SolverCounters counters;
+};
+
+
+// Times one phase from construction until it goes out of scope. CPU time is
+// that of the whole process for the phases that run alone, which may use
+// several threads, and of just this thread for the pipeline phases, which
+// overlap each other.
+class PhaseTimer
+{
+  public:
+    PhaseTimer(Profile *ptrProfile, PHASE_TYPE phase, bool allThreads);
+    ~PhaseTimer();
+
+  private:
+    Profile *ptrProfile;
+    PHASE_TYPE phase;
+    bool allThreads;
+    QElapsedTimer wall;
+    qint64 cpuStart;
+};
+
+#endif // PROFILE_H
@@ -0,0 +1,23 @@
+#ifndef REPORTER_H
+#define REPORTER_H
+
+#include <QString>
+
+// Receives the progress and results of a run from Exec, parseInput() and
+// buildGraph(), so the solver only needs Qt Core. MainWindow shows them in
+// the GUI, and the command-line tool (cli/main.cpp) prints them. Canceling
+// and pausing go the other way, through the flags passed to Exec::go().
+// Everything is called from the thread running the event loop.
+class Reporter
+{
+  public:
+    virtual ~Reporter() {}
+    virtual void setBarFormat(QString fmt, int max) = 0;
+    virtual void setBarVal(int val) = 0;
+    virtual void displayTxt(QString str) = 0;
+    virtual void displayStats(QString status, QString users, QString real, QString viable, QString trades, QString iter) = 0;
+    virtual void inputError(QString str) = 0;      // a fatal problem with the input
+    virtual void runComplete(QString results) = 0; // may delete the Exec
+};
+
+#endif // REPORTER_H
@@ -0,0 +1,34 @@
+#include "symbols.h"
+
+SymbolTable::SymbolTable()
+{
+  clear();
+}
+
+
+// Forgets all strings except the empty one, which is always EMPTY_SYMBOL
+void SymbolTable::clear()
+{
+  ids.clear();
+  strings.clear();
+  intern("");
+}
+
+
+int SymbolTable::intern(const QString &str)
+{
+  int id = ids.value(str, NO_SYMBOL);
+  if (id == NO_SYMBOL)
+  {
+    id = strings.size();
+    strings.append(str);
+    ids.insert(str, id);
+  }
+  return id;
+}
+
+
+int SymbolTable::find(const QString &str) const
+{
+  return ids.value(str, NO_SYMBOL);
+}
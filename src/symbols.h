@@ -0,0 +1,30 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <QString>
+#include <QHash>   // for finding ids by string
+#include <QVector> // for finding strings by id
+
+#define NO_SYMBOL     (-1) // string that was never interned
+#define EMPTY_SYMBOL  0    // the empty string, e.g., an item without an owner
+
+// Interns item names and usernames so the rest of the program can store
+// and compare dense integer ids instead of strings. The strings only come
+// back out through at() when writing output. Ids are handed out in the
+// order strings are first interned.
+class SymbolTable
+{
+  public:
+    SymbolTable();
+    void clear();
+    int intern(const QString &str);     // returns the id of str, adding it if it's new
+    int find(const QString &str) const; // returns the id of str, or NO_SYMBOL
+    const QString &at(int id) const { return strings.at(id); }
+    int size() const { return strings.size(); }
+
+  private:
+    QHash<QString,int> ids;
+    QVector<QString> strings;
+};
+
+#endif // SYMBOLS_H
@@ -0,0 +1,130 @@
+#include <QCoreApplication>
+#include <QCommandLineParser> // for the arguments
+#include <QFile>              // for writing the want file
+#include <stdio.h>            // for writing to stderr
+#include "wantgen.h"
+
+// Reads a number option, complaining if it isn't one or is out of range
+static bool numberOpt(QCommandLineParser &args, const QCommandLineOption &opt,
+                      double min, double max, double *ptrValue)
+{
+  if (!args.isSet(opt))
+    return true;
+  bool ok;
+  double value = args.value(opt).toDouble(&ok);
+  if (!ok || value < min || value > max)
+  {
+    fprintf(stderr, "--%s must be from %g to %g\n", qPrintable(opt.names().last()), min, max);
+    return false;
+  }
+  *ptrValue = value;
+  return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("wantgen");
+
+  QCommandLineParser args;
+  args.setApplicationDescription("Writes a want file in the TradeMaximizer format, for "
+                                 "benchmarks and for trying out options. The same "
+                                 "settings always write the same file.");
+  args.addHelpOption();
+  QCommandLineOption itemsOpt(QStringList() << "n" << "items", "Number of items (default: 1000).", "n", "1000");
+  QCommandLineOption usersOpt(QStringList() << "u" << "users", "Number of users (default: items/4).", "n");
+  QCommandLineOption minOpt("min-wants", "Shortest want list (default: 0).", "n");
+  QCommandLineOption maxOpt("max-wants", "Longest want list (default: 40).", "n");
+  QCommandLineOption lengthsOpt("lengths", "Want list lengths: uniform or geometric (default: uniform).", "dist");
+  QCommandLineOption popOpt("popularity", "Zipf exponent for how often items are wanted; 0 is "
+                            "uniform (default: 1).", "s");
+  QCommandLineOption localOpt("local", "Share of wants for items numbered just after the "
+                              "wanting one (default: 0.5).", "share");
+  QCommandLineOption dummiesOpt("dummies", "Share of users with a dummy item (default: 0).", "share");
+  QCommandLineOption officialOpt("official", "Write an official names block.");
+  QCommandLineOption unlistedOpt("unlisted", "With --official, the share of items with no want "
+                                 "list (default: 0).", "share");
+  QCommandLineOption semiOpt("semicolons", "Chance of a semicolon after each want (default: 0).", "p");
+  QCommandLineOption repeatsOpt("repeats", "Chance that a want repeats an earlier one on its "
+                                "list (default: 0).", "p");
+  QCommandLineOption commOpt("communities", "Split the items and users into <n> groups that "
+                              "only trade among themselves (default: 1).", "n");
+  QCommandLineOption optionsOpt(QStringList() << "O" << "options", "Options for the #! line, e.g., "
+                                "\"LINEAR-PRIORITIES\". With EXPLICIT-PRIORITIES, the wants get "
+                                "=priority annotations.", "options");
+  QCommandLineOption seedOpt("seed", "Random seed (default: 1).", "seed");
+  QCommandLineOption outOpt(QStringList() << "o" << "output",
+                            "Write the want file to <file> instead of stdout.", "file");
+  args.addOption(itemsOpt);
+  args.addOption(usersOpt);
+  args.addOption(minOpt);
+  args.addOption(maxOpt);
+  args.addOption(lengthsOpt);
+  args.addOption(popOpt);
+  args.addOption(localOpt);
+  args.addOption(dummiesOpt);
+  args.addOption(officialOpt);
+  args.addOption(unlistedOpt);
+  args.addOption(semiOpt);
+  args.addOption(repeatsOpt);
+  args.addOption(commOpt);
+  args.addOption(optionsOpt);
+  args.addOption(seedOpt);
+  args.addOption(outOpt);
+  args.process(app);
+
+  WantGenType gen;
+  double numItems = 1000;
+  if (!numberOpt(args, itemsOpt, 1, 100000000, &numItems))
+    return 1;
+  setDefaultWantGen(gen, (int)numItems);
+
+  double numUsers = gen.numUsers, minWants = gen.minWants, maxWants = gen.maxWants;
+  double communities = gen.communities, seed = gen.seed;
+  if (!numberOpt(args, usersOpt, 1, 100000000, &numUsers) ||
+      !numberOpt(args, minOpt, 0, 100000, &minWants) ||
+      !numberOpt(args, maxOpt, 0, 100000, &maxWants) ||
+      !numberOpt(args, popOpt, 0, 10, &gen.popularity) ||
+      !numberOpt(args, localOpt, 0, 1, &gen.localWants) ||
+      !numberOpt(args, dummiesOpt, 0, 1, &gen.dummyUsers) ||
+      !numberOpt(args, unlistedOpt, 0, 1, &gen.unlistedItems) ||
+      !numberOpt(args, semiOpt, 0, 1, &gen.semicolons) ||
+      !numberOpt(args, repeatsOpt, 0, 1, &gen.repeats) ||
+      !numberOpt(args, commOpt, 1, 100000000, &communities) ||
+      !numberOpt(args, seedOpt, 0, 281474976710655.0, &seed))
+    return 1;
+  gen.numUsers = (int)numUsers;
+  gen.minWants = (int)minWants;
+  gen.maxWants = (int)maxWants;
+  gen.communities = (int)communities;
+  gen.seed = (quint64)seed;
+  gen.officialNames = args.isSet(officialOpt);
+  gen.options = args.value(optionsOpt);
+  if (gen.minWants > gen.maxWants)
+  {
+    fprintf(stderr, "--min-wants can't be more than --max-wants\n");
+    return 1;
+  }
+  if (args.value(lengthsOpt) == "geometric")
+    gen.lengths = GEOMETRIC_LENGTHS;
+  else if (args.isSet(lengthsOpt) && args.value(lengthsOpt) != "uniform")
+  {
+    fprintf(stderr, "--lengths must be uniform or geometric\n");
+    return 1;
+  }
+
+  QFile out(args.value(outOpt));
+  bool opened;
+  if (args.value(outOpt).isEmpty())
+    opened = out.open(stdout, QIODevice::WriteOnly);
+  else
+    opened = out.open(QIODevice::WriteOnly);
+  if (!opened)
+  {
+    fprintf(stderr, "Could not write %s\n", qPrintable(args.value(outOpt)));
+    return 1;
+  }
+  out.write(generateWants(gen));
+  return 0;
+}
@@ -0,0 +1,214 @@
+#include "wantgen.h"
+#include "javarand.h"
+#include <QVector>
+#include <math.h>      // for pow()
+#include <algorithm>   // for std::upper_bound()
+
+// A handful of items per user and a couple dozen wants per item, which is
+// about what the OLWLG want files look like
+void setDefaultWantGen(WantGenType &gen, int numItems)
+{
+  gen.numItems = numItems;
+  gen.numUsers = qMax(1, numItems/4);
+  gen.minWants = 0;
+  gen.maxWants = 40;
+  gen.lengths = UNIFORM_LENGTHS;
+  gen.popularity = 1.0;
+  gen.localWants = 0.5;
+  gen.dummyUsers = 0;
+  gen.unlistedItems = 0;
+  gen.semicolons = 0;
+  gen.repeats = 0;
+  gen.communities = 1;
+  gen.officialNames = false;
+  gen.seed = 1;
+}
+
+
+// Picks items so that the k-th most popular one is wanted in proportion to
+// 1/k^popularity. Popularity is dealt out to the items at random, so it has
+// nothing to do with their numbers.
+class Popularity
+{
+  public:
+    Popularity(int numItems, double exponent, JavaRand &rand);
+    int pick(JavaRand &rand) const;
+
+  private:
+    QVector<double> cumulative; // by popularity rank
+    QVector<int> itemAt;        // popularity rank -> item
+};
+
+Popularity::Popularity(int numItems, double exponent, JavaRand &rand)
+{
+  itemAt.resize(numItems);
+  for (int idx=0; idx<numItems; idx++)
+    itemAt[idx] = idx;
+  for (int idx=numItems-1; idx>0; idx--)
+    qSwap(itemAt[idx], itemAt[rand.nextInt(idx+1)]);
+
+  cumulative.resize(numItems);
+  double total = 0;
+  for (int idx=0; idx<numItems; idx++)
+  {
+    total += (exponent == 0) ? 1 : pow(idx+1, -exponent);
+    cumulative[idx] = total;
+  }
+}
+
+int Popularity::pick(JavaRand &rand) const
+{
+  double target = rand.nextDouble() * cumulative.last();
+  int rank = std::upper_bound(cumulative.begin(), cumulative.end(), target) - cumulative.begin();
+  return itemAt.at(qMin(rank, itemAt.size()-1));
+}
+
+
+static int listLength(const WantGenType &gen, JavaRand &rand)
+{
+  if (gen.lengths == UNIFORM_LENGTHS)
+    return gen.minWants + rand.nextInt(gen.maxWants - gen.minWants + 1);
+
+  // Geometric, with the same mean as the uniform lengths would have
+  double extra = (gen.maxWants - gen.minWants) / 2.0;
+  int length = gen.minWants;
+  while (length < gen.maxWants  &&  rand.nextDouble() < extra/(extra+1))
+    length++;
+  return length;
+}
+
+
+// Writes a want file in the TradeMaximizer format. Items are named ITEM0,
+// ITEM1, ... and are dealt out to users at random, and each is wanted
+// according to its popularity. Some of the wants on each list are instead
+// items near the wanting item's number, so there are plenty of short
+// cycles as well as long ones. Users with a dummy item (%DUMMY) put it on
+// their want lists, and its own list holds what they'd take for any of
+// their items. Items left without a want list still get official names
+// when those are written. Repeated wants, if asked for, are the only ones
+// the parser will complain about. With several communities, the items and
+// users are split into that many runs of numbers, and everything a user
+// owns or wants stays within theirs, so the graph falls apart into at least
+// as many strongly connected components.
+QByteArray generateWants(const WantGenType &gen)
+{
+  JavaRand rand(gen.seed);
+  Popularity popularity(gen.numItems, gen.popularity, rand);
+  bool explicitPriorities = gen.options.toUpper().contains("EXPLICIT-PRIORITIES");
+
+  // Community c has the items from firstItem[c] and the users from firstUser[c]
+  int communities = qBound(1, gen.communities, qMin(gen.numItems, gen.numUsers));
+  QVector<int> firstItem(communities+1), firstUser(communities+1);
+  for (int c=0; c<=communities; c++)
+  {
+    firstItem[c] = (int)((qint64)c * gen.numItems / communities);
+    firstUser[c] = (int)((qint64)c * gen.numUsers / communities);
+  }
+  QVector<int> communityOf(gen.numItems), userCommunity(gen.numUsers);
+  for (int c=0; c<communities; c++)
+  {
+    for (int item=firstItem.at(c); item<firstItem.at(c+1); item++)
+      communityOf[item] = c;
+    for (int user=firstUser.at(c); user<firstUser.at(c+1); user++)
+      userCommunity[user] = c;
+  }
+
+  QVector<int> ownerOf(gen.numItems);
+  for (int item=0; item<gen.numItems; item++)
+  {
+    int c = communityOf.at(item);
+    ownerOf[item] = firstUser.at(c) + rand.nextInt(firstUser.at(c+1) - firstUser.at(c));
+  }
+  QVector<bool> hasDummy(gen.numUsers);
+  for (int user=0; user<gen.numUsers; user++)
+    hasDummy[user] = rand.nextDouble() < gen.dummyUsers;
+
+  QByteArray out;
+  out.reserve(gen.numItems * (20 + 8*(gen.minWants+gen.maxWants)/2));
+  out += "#! REQUIRE-COLONS REQUIRE-USERNAMES";
+  if (gen.dummyUsers > 0)
+    out += " ALLOW-DUMMIES";
+  if (!gen.options.isEmpty())
+    out += " " + gen.options.toUtf8();
+  out += '\n';
+
+  if (gen.officialNames)
+  {
+    out += "!BEGIN-OFFICIAL-NAMES\n";
+    for (int item=0; item<gen.numItems; item++)
+      out += "ITEM" + QByteArray::number(item) + "\n";
+    out += "!END-OFFICIAL-NAMES\n";
+  }
+
+  QVector<int> listedIn(gen.numItems, -1); // to keep each list free of repeats
+  for (int item=0; item<gen.numItems; item++)
+  {
+    int user = ownerOf.at(item);
+    int first = firstItem.at(communityOf.at(item)); // of the items it may want
+    int size = firstItem.at(communityOf.at(item)+1) - first;
+    int numWants = listLength(gen, rand);
+    if (gen.officialNames  &&  rand.nextDouble() < gen.unlistedItems)
+      continue;
+
+    out += "(user" + QByteArray::number(user) + ") ITEM" + QByteArray::number(item) + " :";
+    int rank = 1;
+    bool wantsDummy = false;
+    QList<QByteArray> onList; // for the repeats
+    for (int idx=0; idx<numWants; idx++)
+    {
+      QByteArray want;
+      // Only draw for repeats when they're wanted, so the files written
+      // without them stay the same
+      if (gen.repeats > 0  &&  !onList.isEmpty()  &&  rand.nextDouble() < gen.repeats)
+        want = onList.at(rand.nextInt(onList.size()));
+      else if (hasDummy.at(user)  &&  !wantsDummy  &&  rand.nextInt(numWants) == 0)
+      {
+        want = "%DUMMY";
+        wantsDummy = true;
+      }
+      else
+      {
+        int wanted;
+        if (rand.nextDouble() < gen.localWants)
+          wanted = first + (item - first + 1 + rand.nextInt(50)) % size;
+        else
+          wanted = first + popularity.pick(rand) % size;
+        if (listedIn.at(wanted) == item  ||  ownerOf.at(wanted) == user)
+          continue;
+        listedIn[wanted] = item;
+        want = "ITEM" + QByteArray::number(wanted);
+      }
+      onList.append(want);
+      if (explicitPriorities)
+        want += "=" + QByteArray::number(rank);
+      out += " " + want;
+      rank++;
+      if (rand.nextDouble() < gen.semicolons)
+        out += " ;";
+    }
+    out += '\n';
+  }
+
+  for (int user=0; user<gen.numUsers; user++)
+  {
+    if (!hasDummy.at(user))
+      continue;
+    out += "(user" + QByteArray::number(user) + ") %DUMMY :";
+    int first = firstItem.at(userCommunity.at(user));
+    int size = firstItem.at(userCommunity.at(user)+1) - first;
+    int numWants = qMax(1, listLength(gen, rand));
+    int rank = 1;
+    for (int idx=0; idx<numWants; idx++)
+    {
+      int wanted = first + popularity.pick(rand) % size;
+      if (ownerOf.at(wanted) == user  ||  listedIn.at(wanted) == gen.numItems + user)
+        continue;
+      listedIn[wanted] = gen.numItems + user;
+      out += " ITEM" + QByteArray::number(wanted);
+      if (explicitPriorities)
+        out += "=" + QByteArray::number(rank++);
+    }
+    out += '\n';
+  }
+  return out;
+}
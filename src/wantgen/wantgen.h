@@ -0,0 +1,37 @@
+#ifndef WANTGEN_H
+#define WANTGEN_H
+
+#include <QByteArray>
+#include <QString>
+
+typedef enum
+{
+  UNIFORM_LENGTHS   = 0, // want list lengths spread evenly from minWants to maxWants
+  GEOMETRIC_LENGTHS = 1, // mostly short lists, with a long tail up to maxWants
+} LENGTH_TYPE;
+
+// Settings for generateWants(). Every run with the same settings writes
+// the same file.
+typedef struct
+{
+  int numItems;
+  int numUsers;
+  int minWants;          // shortest want list
+  int maxWants;          // longest want list
+  LENGTH_TYPE lengths;
+  double popularity;     // Zipf exponent for how often items are wanted; 0 is uniform
+  double localWants;     // share of wants picked from just after the wanting item
+  double dummyUsers;     // share of users with a dummy item
+  double unlistedItems;  // share of official names with no want list
+  double semicolons;     // chance of a semicolon after each want
+  double repeats;        // chance that a want repeats an earlier one on its list
+  int communities;       // groups of items and users that never want each other's items
+  bool officialNames;    // write an official names block
+  QString options;       // for the #! line, e.g., "LINEAR-PRIORITIES"
+  quint64 seed;
+} WantGenType;
+
+void setDefaultWantGen(WantGenType &gen, int numItems);
+QByteArray generateWants(const WantGenType &gen);
+
+#endif // WANTGEN_H
@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# wantgen: writes generated want files for benchmarks and experiments
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = wantgen
+TEMPLATE = app
+CONFIG   += console
+CONFIG   -= app_bundle
+
+INCLUDEPATH += ..
+DEPENDPATH  += ..
+
+SOURCES += main.cpp \
+    wantgen.cpp \
+    ../javarand.cpp
+
+HEADERS += wantgen.h \
+    ../javarand.h